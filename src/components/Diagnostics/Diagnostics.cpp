@@ -0,0 +1,200 @@
+#include "Diagnostics.hpp"
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include <stdio.h>
+#include <atomic>
+#include <algorithm>
+
+extern "C" {
+  #include "freertos/FreeRTOS.h"
+  #include "freertos/task.h"
+}
+
+#define MS_TO_TICKS( xTimeInMs ) (uint32_t)( ( ( TickType_t ) xTimeInMs * configTICK_RATE_HZ ) / ( TickType_t ) 1000 )
+
+namespace Diagnostics {
+
+  static_assert( (DIAG_LOG_LEN & (DIAG_LOG_LEN - 1)) == 0,
+                 "DIAG_LOG_LEN must be a power of two" );
+
+  LogStats logStats = {};
+
+  // Slots are claimed with an atomic index and published once filled, so
+  // tasks can register while another one reports.
+  struct Counter {
+    const char*             name;
+    const volatile uint32_t* value;
+    std::atomic<bool>       ready;
+  };
+  static Counter          counters[ DIAG_MAX_COUNTERS ];
+  static std::atomic<int> numCounters( 0 );
+
+  bool addCounter( const char* name, const volatile uint32_t* value ) {
+    int slot = numCounters.fetch_add( 1 );
+    if ( slot >= DIAG_MAX_COUNTERS )
+      return false;
+    counters[slot].name  = name;
+    counters[slot].value = value;
+    counters[slot].ready.store( true, std::memory_order_release );
+    return true;
+  }
+
+  // published the same way as the counters
+  struct ReporterSlot {
+    Reporter          reporter;
+    std::atomic<bool> ready;
+  };
+  static ReporterSlot     reporters[ DIAG_MAX_REPORTERS ];
+  static std::atomic<int> numReporters( 0 );
+
+  bool addReporter( Reporter reporter ) {
+    int slot = numReporters.fetch_add( 1 );
+    if ( slot >= DIAG_MAX_REPORTERS )
+      return false;
+    reporters[slot].reporter = reporter;
+    reporters[slot].ready.store( true, std::memory_order_release );
+    return true;
+  }
+
+  // Everything a log call passed, formatted only when it is printed.
+  struct Record {
+    uint32_t    stamp;       // ms since boot
+    Level       level;
+    const char* tag;
+    const char* fmt;
+    int         args[5];
+    uint32_t    suppressed;  // by this call site since its previous record
+  };
+
+  // Call sites are told apart by their format string.
+  struct Site {
+    const char* fmt;
+    uint32_t    last;        // ms, stamp of its last record
+    uint32_t    suppressed;
+  };
+
+  // The ring and the sites are shared by every task that logs.  Writers
+  // only try the lock once and drop their record if it is taken, so
+  // logging never waits; the reader yields until it gets it.
+  static std::atomic_flag logLock = ATOMIC_FLAG_INIT;
+  static Record   records[ DIAG_LOG_LEN ];
+  static uint32_t logHead = 0;
+  static uint32_t logTail = 0;
+  static Site     sites[ DIAG_LOG_SITES ];
+
+  static TaskHandle_t diagTask = NULL;
+
+  static void countDrop( void ) {
+    __atomic_fetch_add( &logStats.dropped, 1, __ATOMIC_RELAXED );
+  }
+
+  void log( Level level, const char* tag, const char* fmt, int a, int b, int c, int d, int e ) {
+    uint32_t now = (uint32_t) (esp_timer_get_time() / 1000);
+    if ( logLock.test_and_set( std::memory_order_acquire ) ) {
+      countDrop();
+      return;
+    }
+    Site* site = nullptr;
+    for (int i=0; i<DIAG_LOG_SITES && site == nullptr; i++) {
+      if ( sites[i].fmt == fmt || sites[i].fmt == nullptr )
+        site = &sites[i];
+    }
+    if ( site != nullptr && site->fmt == fmt && now - site->last < DIAG_LOG_INTERVAL_MS ) {
+      site->suppressed++;
+      logStats.suppressed++;
+    }
+    else if ( logHead - logTail == DIAG_LOG_LEN ) {
+      countDrop();
+    }
+    else {
+      Record& r = records[ logHead++ & (DIAG_LOG_LEN - 1) ];
+      r.stamp = now;
+      r.level = level;
+      r.tag   = tag;
+      r.fmt   = fmt;
+      r.args[0] = a;
+      r.args[1] = b;
+      r.args[2] = c;
+      r.args[3] = d;
+      r.args[4] = e;
+      r.suppressed = 0;
+      if ( site != nullptr ) {
+        r.suppressed = site->suppressed;
+        site->fmt = fmt;
+        site->last = now;
+        site->suppressed = 0;
+      }
+      logStats.records++;
+    }
+    logLock.clear( std::memory_order_release );
+  }
+
+  static bool takeRecord( Record& r ) {
+    while ( logLock.test_and_set( std::memory_order_acquire ) )
+      vTaskDelay( 1 );
+    bool any = logTail != logHead;
+    if ( any )
+      r = records[ logTail++ & (DIAG_LOG_LEN - 1) ];
+    logLock.clear( std::memory_order_release );
+    return any;
+  }
+
+  // Each record is formatted into a line of at most DIAG_LINE_LEN bytes
+  // and written in one go, so a long tag or format costs neither stack
+  // nor transmit time beyond that.
+  void drainLog( void ) {
+    static const char levels[] = { 'I', 'W', 'E' };
+    char line[ DIAG_LINE_LEN ];
+    Record r;
+    while ( takeRecord( r ) ) {
+      int n = snprintf( line, sizeof(line), "%c (%u) %s: ", levels[ r.level ], r.stamp, r.tag );
+      n = std::min( n, (int) sizeof(line) - 1 );
+      n += snprintf( line + n, sizeof(line) - n, r.fmt, r.args[0], r.args[1], r.args[2], r.args[3], r.args[4] );
+      n = std::min( n, (int) sizeof(line) - 1 );
+      if ( r.suppressed > 0 ) {
+        n += snprintf( line + n, sizeof(line) - n, " (%u more before this)", r.suppressed );
+        n = std::min( n, (int) sizeof(line) - 1 );
+      }
+      line[ n ] = '\n';
+      fwrite( line, 1, n + 1, stdout );
+    }
+  }
+
+  void report( void ) {
+    int n = std::min( numCounters.load(), DIAG_MAX_COUNTERS );
+    printf( "stats:\n" );
+    for (int i=0; i<n; i++) {
+      if ( counters[i].ready.load( std::memory_order_acquire ) )
+        printf( "%s=%u\n", counters[i].name, *counters[i].value );
+    }
+    n = std::min( numReporters.load(), DIAG_MAX_REPORTERS );
+    for (int i=0; i<n; i++) {
+      if ( reporters[i].ready.load( std::memory_order_acquire ) )
+        reporters[i].reporter();
+    }
+    drainLog();
+  }
+
+  void requestReport( void ) {
+    if ( diagTask != NULL )
+      xTaskNotifyGive( diagTask );
+  }
+
+  static void diagnosticsTask( void *pvParameter ) {
+    for (;;) {
+      TickType_t wait = DIAG_DRAIN_MS ? MS_TO_TICKS(DIAG_DRAIN_MS) : (TickType_t) portMAX_DELAY;
+      if ( ulTaskNotifyTake( pdTRUE, wait ) )
+        report();
+      else
+        drainLog();
+    }
+  }
+
+  void start( void ) {
+    addCounter( "log.records",    &logStats.records );
+    addCounter( "log.suppressed", &logStats.suppressed );
+    addCounter( "log.dropped",    &logStats.dropped );
+    xTaskCreate( diagnosticsTask, "diagnostics", DIAG_TASK_STACK, NULL, DIAG_TASK_PRIORITY, &diagTask );
+  }
+
+};
@@ -0,0 +1,89 @@
+#ifndef __Diagnostics__INCLUDE_GUARD
+#define __Diagnostics__INCLUDE_GUARD
+
+#include <cstdint>
+
+// Counters and log records for the data path, kept in memory instead of
+// being printed where they happen: UART0 carries the incoming data as
+// well as the console, so every synchronous log line costs transmit time
+// and blocks its task in printf.  Records are printed later by a low
+// priority task, and counters only on request ("+++STATS").
+
+// counters that can be registered
+#ifndef DIAG_MAX_COUNTERS
+#define DIAG_MAX_COUNTERS   64
+#endif
+// functions that print more than counters in a report
+#ifndef DIAG_MAX_REPORTERS
+#define DIAG_MAX_REPORTERS  4
+#endif
+// log records held until they are printed, a power of two
+#ifndef DIAG_LOG_LEN
+#define DIAG_LOG_LEN        32
+#endif
+// each call site logs at most once per interval, the rest are counted
+#ifndef DIAG_LOG_INTERVAL_MS
+#define DIAG_LOG_INTERVAL_MS 1000
+#endif
+// call sites the rate limit can tell apart
+#ifndef DIAG_LOG_SITES
+#define DIAG_LOG_SITES      16
+#endif
+// how often waiting records are printed, 0 for only on request
+#ifndef DIAG_DRAIN_MS
+#define DIAG_DRAIN_MS       1000
+#endif
+// longest line a record is printed as, the rest is cut off
+#ifndef DIAG_LINE_LEN
+#define DIAG_LINE_LEN       128
+#endif
+// The printing task runs at idle priority by default, so it only drains
+// the ring while every other task is blocked; one that busy-waits keeps
+// it from running at all and new records are then counted as dropped.
+#ifndef DIAG_TASK_PRIORITY
+#define DIAG_TASK_PRIORITY  tskIDLE_PRIORITY
+#endif
+// enough for newlib's printf along with the line buffer
+#ifndef DIAG_TASK_STACK
+#define DIAG_TASK_STACK     4096
+#endif
+
+namespace Diagnostics {
+
+  enum Level { INFO, WARN, ERROR };
+
+  struct LogStats {
+    uint32_t records;     // kept for printing
+    uint32_t suppressed;  // over a call site's rate limit
+    uint32_t dropped;     // lost to a full ring or a concurrent writer
+  };
+  extern LogStats logStats;
+
+  // Makes a counter owned by the caller show up in reports under name.
+  // Both must stay valid; the counter is only ever read.
+  bool addCounter ( const char* name, const volatile uint32_t* value );
+
+  // Has reporter called, from the diagnostics task, after the counters
+  // of every report, for state that does not fit a fixed counter.
+  typedef void (*Reporter)( void );
+  bool addReporter ( Reporter reporter );
+
+  // Keeps a record for later, without formatting it: fmt must be a string
+  // literal that takes up to five int arguments.  Never blocks, safe from
+  // any task but not from an ISR.
+  void log ( Level level, const char* tag, const char* fmt,
+             int a = 0, int b = 0, int c = 0, int d = 0, int e = 0 );
+
+  // prints the waiting log records, from the diagnostics task
+  void drainLog ( void );
+  // prints every counter and then the log
+  void report ( void );
+  // has the diagnostics task report as soon as it gets to run
+  void requestReport ( void );
+
+  // starts the low priority task that does the printing
+  void start ( void );
+
+};
+
+#endif // __Diagnostics__INCLUDE_GUARD
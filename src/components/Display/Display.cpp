@@ -2,60 +2,16 @@
 extern "C" {
   #include <string.h>
   #include <stdio.h>
-  #include "sdkconfig.h"
-  #include "rom/ets_sys.h"
-  #include "rom/gpio.h"
-  #include "soc/gpio_reg.h"
-  #include "soc/gpio_sig_map.h"
-  #include "soc/gpio_struct.h"
-  #include "soc/io_mux_reg.h"
-  #include "soc/spi_reg.h"
-  #include "freertos/FreeRTOS.h"
-  #include "freertos/task.h"
+  #include <stdlib.h>
 }
 #include "Fonts.hpp"
-
-#define U16x2toU32(m,l) ((((uint32_t)(l>>8|(l&0xFF)<<8))<<16)|(m>>8|(m&0xFF)<<8))
+#include "VramLayout.hpp"
 
 #define MAX(a,b) ((a) > (b) ? a : b)
 #define MIN(a,b) ((a) < (b) ? a : b)
 
-#if CONFIG_LCD_USE_FAST_PINS
-#define PIN_NUM_MISO 19
-#define PIN_NUM_MOSI 23
-#define PIN_NUM_CLK  18
-#define PIN_NUM_CS   5
-
-#define PIN_NUM_DC   21
-#define PIN_NUM_RST  22
-#define PIN_NUM_BCKL 25
-#else
-#define PIN_NUM_MISO 25
-#define PIN_NUM_MOSI 23
-#define PIN_NUM_CLK  19
-#define PIN_NUM_CS   22
-
-#define PIN_NUM_DC   21
-#define PIN_NUM_RST  18
-#define PIN_NUM_BCKL 5
-#endif
-
-#define LCD_SEL_CMD()   GPIO.out_w1tc = (1 << PIN_NUM_DC) // Low to send command 
-#define LCD_SEL_DATA()  GPIO.out_w1ts = (1 << PIN_NUM_DC) // High to send data
-#define LCD_RST_SET()   GPIO.out_w1ts = (1 << PIN_NUM_RST) 
-#define LCD_RST_CLR()   GPIO.out_w1tc = (1 << PIN_NUM_RST)
-
-#ifdef CONFIG_WROVER_KIT_V1
- #define LCD_BKG_ON()    GPIO.out_w1ts = (1 << PIN_NUM_BCKL) // Backlight ON
- #define LCD_BKG_OFF()   GPIO.out_w1tc = (1 << PIN_NUM_BCKL) // Backlight OFF
-#else
- #define LCD_BKG_ON()    GPIO.out_w1tc = (1 << PIN_NUM_BCKL) // Backlight ON
- #define LCD_BKG_OFF()   GPIO.out_w1ts = (1 << PIN_NUM_BCKL) // Backlight OFF
-#endif
-
-#define SPI_NUM  0x3
 
-uint8_t  vram[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+uint8_t  vram[DISPLAY_WIDTH * DISPLAY_HEIGHT] __attribute__((aligned(4))); // word reads in scanout / hashing
 uint16_t myPalette[256] = {
   0,8,23,31,256,264,279,287,512,520,535,543,768,776,791,799,1248,1256,1271,1279,1504,
   1512,1527,1535,1760,1768,1783,1791,2016,2024,2039,2047,8192,8200,8215,8223,8448,8456,
@@ -81,14 +37,14 @@ uint16_t myPalette[256] = {
 void Draw_5x8_char(char* _char_matrix,int x_start,int y_start,unsigned char clr)
 {
   int row, col;
-  
+  mark_dirty(x_start, y_start, 5, 8);
   for (col=0;col<=4;col++) {
     for (row=0;row<=7;row++) {
       if ((row+y_start)>=0 && (row+y_start)< DISPLAY_HEIGHT && (col+x_start)>=0 && (col+x_start)< DISPLAY_WIDTH) {
         if (((_char_matrix[row]>>(7-col))&0x01))
-          vram[(row+y_start) + (col+x_start) * DISPLAY_HEIGHT] = clr;
+          vram[vram_layout::index((col+x_start), (row+y_start))] = clr;
         else
-          vram[(row+y_start) + (col+x_start) * DISPLAY_HEIGHT] = 0x00;
+          vram[vram_layout::index((col+x_start), (row+y_start))] = 0x00;
        }
     }
   }
@@ -104,13 +60,14 @@ void Draw_8x12_char(char* _char_matrix,int x_start,int y_start,unsigned char clr
 {
   int row;
   int col;
+  mark_dirty(x_start, y_start, 8, 12);
   for (row=0;row<12;row++) {
     for (col=0;col<8;col++) {
       if ((row+y_start)>=0 && (row+y_start)< DISPLAY_HEIGHT && (col+x_start)>=0 && (col+x_start)< DISPLAY_WIDTH) {
         if (((_char_matrix[row]>>(7-col))&0x01))
-          vram[(row+y_start) + (col+x_start) * DISPLAY_HEIGHT] = clr;
+          vram[vram_layout::index((col+x_start), (row+y_start))] = clr;
         else
-          vram[(row+y_start) + (col+x_start) * DISPLAY_HEIGHT] = 0x00;
+          vram[vram_layout::index((col+x_start), (row+y_start))] = 0x00;
        }
     }
   }
@@ -120,7 +77,7 @@ void Draw_8x12_string(char* str,unsigned char len,int x_start,int y_start,unsign
 {
   int i = 0;
   for (i=0;i<len;i++) {
-    Draw_8x12_char((char *)char8x12_matrix[(int)str[i]],x_start+i*9,y_start,clr);
+    Draw_8x12_char((char *)char8x12_matrix[(int)str[i]],x_start+i*FONT_8X12_ADVANCE,y_start,clr);
   }
 }
 
@@ -133,48 +90,48 @@ void draw_rectangle(
 		const uint8_t  outline,
 		const uint8_t  fill) {
   int row;
-  int col;
   int xLeft = pos.x - width/2,
 		  xRight = pos.x + width/2,
 		  yTop = pos.y - height/2,
 		  yBottom = pos.y + height/2;
-  for (row=yTop;row<=yBottom;row++) {
-	for (col=xLeft;col<=xRight;col++) {
-	  if (row>=0 && col>=0 && row<DISPLAY_HEIGHT && col<DISPLAY_WIDTH) {
-		  if ( ((col-xLeft)<2) ||
-				  ((xRight-col)<2) ||
-				  ((row-yTop)<2) ||
-				  ((yBottom-row)<2))
-			  vram[row + col * DISPLAY_HEIGHT] = outline;
-		  else vram[row + col * DISPLAY_HEIGHT] = fill;
-	  }
-	}
+  mark_dirty(xLeft, yTop, xRight - xLeft + 1, yBottom - yTop + 1);
+  // clip once, then draw each row as an outline span with the fill on top
+  int xs = MAX(xLeft, 0),
+		  xe = MIN(xRight, DISPLAY_WIDTH - 1),
+		  fs = MAX(xs, xLeft + 2),
+		  fe = MIN(xe, xRight - 2);
+  if (xs > xe)
+	return;
+  for (row=MAX(yTop, 0);row<=MIN(yBottom, DISPLAY_HEIGHT - 1);row++) {
+	vram_layout::fill_span(vram, xs, row, xe - xs + 1, outline);
+	if ((row-yTop)>=2 && (yBottom-row)>=2 && fe >= fs)
+	  vram_layout::fill_span(vram, fs, row, fe - fs + 1, fill);
   }
-  //blit_vram(xLeft, yTop, xRight - xLeft, yBottom - yTop);
 }
 
 void plot4points(int cx, int cy, int x, int y, unsigned char clroutline,unsigned char clrfill)
 {
-  int row,col;
-  for (row = cy-y;row<=(cy+y);row++) {
-    for (col=cx-x;col<=(cx+x);col++) {
-	  if (row>=0 && row< DISPLAY_HEIGHT && col>=0 && col< DISPLAY_WIDTH) vram[row + col * DISPLAY_HEIGHT] = clrfill;
-	}
+  int row;
+  int xs = MAX(cx-x, 0),
+    xe = MIN(cx+x, DISPLAY_WIDTH - 1);
+  if (xs <= xe) {
+    for (row = MAX(cy-y, 0);row<=MIN(cy+y, DISPLAY_HEIGHT - 1);row++)
+      vram_layout::fill_span(vram, xs, row, xe - xs + 1, clrfill);
   }
   if ((cy+y)>=0 && (cy+y)< DISPLAY_HEIGHT && (cx+x)>=0 && (cx+x)< DISPLAY_WIDTH)
-	vram[(cy+y) + (cx+x) * DISPLAY_HEIGHT] = clroutline;
+	vram[vram_layout::index((cx+x), (cy+y))] = clroutline;
 
   if (x != 0) {
     if ((cy+y)>=0 && (cy+y)< DISPLAY_HEIGHT && (cx-x)>=0 && (cx-x)< DISPLAY_WIDTH)
-      vram[(cy+y) + (cx-x) * DISPLAY_HEIGHT] = clroutline;
+      vram[vram_layout::index((cx-x), (cy+y))] = clroutline;
   }
   if (y != 0) {
     if ((cy-y)>=0 && (cy-y)< DISPLAY_HEIGHT && (cx+x)>=0 && (cx+x)< DISPLAY_WIDTH)
-      vram[(cy-y) + (cx+x) * DISPLAY_HEIGHT] = clroutline;
+      vram[vram_layout::index((cx+x), (cy-y))] = clroutline;
   }
   if (x != 0 && y != 0) {
     if ((cy-y)>=0 && (cy-y)< DISPLAY_HEIGHT && (cx-x)>=0 && (cx-x)< DISPLAY_WIDTH)
-      vram[(cy-y) + (cx-x) * DISPLAY_HEIGHT] = clroutline;
+      vram[vram_layout::index((cx-x), (cy-y))] = clroutline;
   }
 }
 
@@ -215,6 +172,7 @@ void draw_circle(
 		const uint8_t  fill) {
   int cx = pos.x,
 		  cy = pos.y;
+  mark_dirty(cx - radius, cy - radius, 2 * radius + 1, 2 * radius + 1);
   circle(cx, cy, radius, outline, fill);
 }
 
@@ -222,11 +180,26 @@ void draw_line(
 		const point_s start,
 		const point_s end,
 		const uint8_t color) {
+  draw_line(start, end, color, 0, DISPLAY_WIDTH - 1);
+}
+
+void draw_line(
+		const point_s start,
+		const point_s end,
+		const uint8_t color,
+		const uint16_t xMin,
+		const uint16_t xMax) {
   int _dummy;
   int xLeft = start.x,
 		  xRight = end.x,
 		  yTop = start.y,
 		  yBottom = end.y;
+  int xFrom = MAX(MIN(xLeft, xRight), xMin),
+      xTo = MIN(MAX(xLeft, xRight), xMax);
+  if (xFrom > xTo)
+    return;
+  mark_dirty(xFrom, MIN(yTop, yBottom),
+             xTo - xFrom + 1, abs(yBottom - yTop) + 1);
   int steep = (abs(yBottom - yTop) > abs(xRight - xLeft));
   if (steep) {
 	_dummy = xLeft;
@@ -255,10 +228,10 @@ void draw_line(
   int col;
 
   for (col = xLeft;col <= xRight;col++) {
-	if (row>=0 && col>=0 && row< DISPLAY_HEIGHT && col< DISPLAY_WIDTH) {
-	  if (steep) vram[col + row * DISPLAY_HEIGHT] = color;
-	  else       vram[row + col * DISPLAY_HEIGHT] = color;
-	}
+	int x = steep ? row : col,
+	    y = steep ? col : row;
+	if (x>=xFrom && y>=0 && x<=xTo && x< DISPLAY_WIDTH && y< DISPLAY_HEIGHT)
+	  vram[vram_layout::index(x, y)] = color;
 	error = error - dy;
 	if (error<0) {
 	  row = row + ystep;
@@ -269,6 +242,17 @@ void draw_line(
 
 
 // LOW LEVEL FUNCTIONS:
+#if defined(ESP_PLATFORM) && CONFIG_LCD_USE_DMA
+static const lcd_bus_s *lcd_bus = &lcd_spi_dma_bus;
+#elif defined(ESP_PLATFORM)
+static const lcd_bus_s *lcd_bus = &lcd_spi_bus;
+#else
+static const lcd_bus_s *lcd_bus = NULL; // must be provided with lcd_set_bus()
+#endif
+static lcd_bus_stats_s lcd_stats;
+// palette converted scanout buffers: the bus sends one while the CPU fills the other
+static uint32_t lcd_pixel_buf[2][LCD_PIXEL_BUF_LEN / 2];
+
 // forward declare main low level func for displaying to screen:
 void ili9341_write_frame(
 		const uint16_t x,
@@ -276,9 +260,102 @@ void ili9341_write_frame(
 		const uint16_t width,
 		const uint16_t height,
 		const uint8_t *data);
+static void lcd_command(
+		const uint8_t cmd);
+static void lcd_data(
+		const uint8_t *data,
+		const uint32_t len);
+static void lcd_write_window(
+		const uint16_t xs,
+		const uint16_t ys,
+		const uint16_t width,
+		const uint16_t height,
+		const uint8_t *fb);
+
+// DAMAGE TRACKING:
+// Regions closer than this many pixels are merged, since setting up a new
+// window costs about as much SPI time as sending a few extra pixels.
+#define DIRTY_MERGE_SLACK 8
+
+static rect_s dirtyRects[MAX_DIRTY_RECTS];
+static int    numDirtyRects = 0;
+
+static bool rects_touch(const rect_s& a, const rect_s& b) {
+  return
+    a.x <= b.x + b.width  + DIRTY_MERGE_SLACK &&
+    b.x <= a.x + a.width  + DIRTY_MERGE_SLACK &&
+    a.y <= b.y + b.height + DIRTY_MERGE_SLACK &&
+    b.y <= a.y + a.height + DIRTY_MERGE_SLACK;
+}
+
+static rect_s rect_union(const rect_s& a, const rect_s& b) {
+  uint16_t xs = MIN(a.x, b.x),
+    ys = MIN(a.y, b.y),
+    xe = MAX(a.x + a.width, b.x + b.width),
+    ye = MAX(a.y + a.height, b.y + b.height);
+  return { xs, ys, (uint16_t)(xe - xs), (uint16_t)(ye - ys) };
+}
+
+static uint32_t rect_area(const rect_s& r) {
+  return (uint32_t)r.width * r.height;
+}
+
+static void remove_dirty_rect(int index) {
+  dirtyRects[index] = dirtyRects[--numDirtyRects];
+}
+
+void mark_dirty(int x, int y, int width, int height) {
+  int xs = MAX(0, x),
+    xe = MIN(DISPLAY_WIDTH, x + width),
+    ys = MAX(0, y),
+    ye = MIN(DISPLAY_HEIGHT, y + height);
+  if (xs >= xe || ys >= ye)
+    return;
+  rect_s r = { (uint16_t)xs, (uint16_t)ys, (uint16_t)(xe - xs), (uint16_t)(ye - ys) };
+  while (true) {
+    // absorb every region the new one touches; the union can grow
+    // into regions already checked, so restart after each merge
+    int i = 0;
+    while (i < numDirtyRects) {
+      if (rects_touch(r, dirtyRects[i])) {
+        r = rect_union(r, dirtyRects[i]);
+        remove_dirty_rect(i);
+        i = 0;
+      }
+      else
+        i++;
+    }
+    if (numDirtyRects < MAX_DIRTY_RECTS)
+      break;
+    // list is full: merge with the region whose union adds the least area
+    int best = 0;
+    uint32_t bestCost = UINT32_MAX;
+    for (i=0; i<numDirtyRects; i++) {
+      uint32_t cost = rect_area(rect_union(r, dirtyRects[i])) - rect_area(dirtyRects[i]);
+      if (cost < bestCost) {
+        bestCost = cost;
+        best = i;
+      }
+    }
+    r = rect_union(r, dirtyRects[best]);
+    remove_dirty_rect(best);
+  }
+  dirtyRects[numDirtyRects++] = r;
+}
+
+void mark_all_dirty() {
+  dirtyRects[0] = { 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT };
+  numDirtyRects = 1;
+}
+
+int get_dirty_rects(const rect_s** rects) {
+  *rects = dirtyRects;
+  return numDirtyRects;
+}
 
 void clear_vram() {
 	memset(vram, 0, DISPLAY_WIDTH * DISPLAY_HEIGHT);
+	mark_all_dirty();
 }
 
 void clear_vram(
@@ -291,110 +368,245 @@ void clear_vram(
   ys = MAX(0, y),
   ye = MIN(DISPLAY_HEIGHT, ys + height),
   len = ye - ys;
-  for (int i=xs; i<xe; i++) {
-    memset( &vram[ ys + i * DISPLAY_HEIGHT ], 0, len );
+  mark_dirty(xs, ys, xe - xs, len);
+  if (xe > xs && len > 0)
+    vram_layout::fill_rect( vram, xs, ys, xe - xs, len, 0 );
+}
+
+// TILE DIFFERENCING:
+// Damaged regions are often repainted with identical pixels (windows are
+// cleared and fully redrawn), so flush_vram() hashes the 16x16 tiles under
+// the damage and only sends tiles whose hash changed since they were last
+// sent, merged into horizontal runs.  Hashing a tile reads 256 bytes with
+// word loads, far cheaper than the 512 bytes of SPI it may save.
+#define HASH_TILE_SIZE 16
+#define HASH_TILES_X   (DISPLAY_WIDTH / HASH_TILE_SIZE)
+#define HASH_TILES_Y   (DISPLAY_HEIGHT / HASH_TILE_SIZE)
+
+static void blit_rects(
+		const rect_s *rects,
+		const int count);
+
+#if CONFIG_VRAM_TILE_HASH
+static uint32_t tileHash[HASH_TILES_X * HASH_TILES_Y];
+static bool     tileValid[HASH_TILES_X * HASH_TILES_Y];
+static uint8_t  tileDamaged[HASH_TILES_X * HASH_TILES_Y];
+static rect_s   tileRuns[(HASH_TILES_X + 1) / 2 * HASH_TILES_Y];
+
+static uint32_t hash_tile(const int tx, const int ty) {
+  return vram_layout::hash_rect(vram, tx * HASH_TILE_SIZE, ty * HASH_TILE_SIZE, HASH_TILE_SIZE, HASH_TILE_SIZE);
+}
+
+// calls func(tile index) for every tile that rect overlaps
+template <typename F>
+static void for_each_tile(const rect_s& r, F func) {
+  int tx, ty;
+  for (ty = r.y / HASH_TILE_SIZE; ty <= (r.y + r.height - 1) / HASH_TILE_SIZE && ty < HASH_TILES_Y; ty++)
+    for (tx = r.x / HASH_TILE_SIZE; tx <= (r.x + r.width - 1) / HASH_TILE_SIZE && tx < HASH_TILES_X; tx++)
+      func(ty * HASH_TILES_X + tx);
+}
+
+static void invalidate_tiles(const rect_s& r) {
+  if (r.width == 0 || r.height == 0)
+    return;
+  for_each_tile(r, [](int t) { tileValid[t] = false; });
+}
+
+// the panel now matches vram everywhere
+static void rehash_all_tiles() {
+  for (int ty=0; ty<HASH_TILES_Y; ty++) {
+    for (int tx=0; tx<HASH_TILES_X; tx++) {
+      tileHash[ty * HASH_TILES_X + tx] = hash_tile(tx, ty);
+      tileValid[ty * HASH_TILES_X + tx] = true;
+    }
+  }
+}
+
+static void flush_changed_tiles() {
+  int i, tx, ty, t, runStart, numRuns = 0;
+  uint32_t h;
+  bool changed;
+  memset(tileDamaged, 0, sizeof(tileDamaged));
+  for (i=0; i<numDirtyRects; i++)
+    for_each_tile(dirtyRects[i], [](int t) { tileDamaged[t] = 1; });
+  for (ty=0; ty<HASH_TILES_Y; ty++) {
+    runStart = -1;
+    // one step past the last tile closes any open run
+    for (tx=0; tx<=HASH_TILES_X; tx++) {
+      changed = false;
+      t = ty * HASH_TILES_X + tx;
+      if (tx < HASH_TILES_X && tileDamaged[t]) {
+        h = hash_tile(tx, ty);
+        if (!tileValid[t] || h != tileHash[t]) {
+          tileHash[t] = h;
+          tileValid[t] = true;
+          changed = true;
+        }
+      }
+      if (changed && runStart < 0)
+        runStart = tx;
+      else if (!changed && runStart >= 0) {
+        tileRuns[numRuns++] = {
+          (uint16_t)(runStart * HASH_TILE_SIZE),
+          (uint16_t)(ty * HASH_TILE_SIZE),
+          (uint16_t)((tx - runStart) * HASH_TILE_SIZE),
+          HASH_TILE_SIZE
+        };
+        runStart = -1;
+      }
+    }
   }
+  blit_rects(tileRuns, numRuns);
+}
+#endif // CONFIG_VRAM_TILE_HASH
+
+// HARDWARE SCROLLING:
+// The panel scrolls a band of its 320 memory lines.  This driver steps
+// through those with the page address (PASET), so they are the vram rows;
+// MockPanel composes its scanout on the same assumption and test_scroll
+// pins the MADCTL value it was made for.  vram keeps
+// mirroring panel memory, so a scrolled area is drawn through
+// scroll_row(), which maps a row on screen to the vram row behind it.
+// Register writes are deferred to the next flush so new content is on the
+// panel before it scrolls into view.
+static uint16_t scrollTop = 0;
+static uint16_t scrollHeight = DISPLAY_HEIGHT;
+static uint16_t scrollOffset = 0;
+static bool     scrollAreaPending = false;
+static bool     scrollStartPending = false;
+
+void set_scroll_area(const uint16_t top, const uint16_t height) {
+  scrollTop = MIN(top, DISPLAY_HEIGHT);
+  scrollHeight = MIN(height, DISPLAY_HEIGHT - scrollTop);
+  scrollOffset = 0;
+  scrollAreaPending = true;
+  scrollStartPending = true;
+}
+
+void scroll_area(const uint16_t lines) {
+  if (scrollHeight == 0)
+    return;
+  scrollOffset = (scrollOffset + lines) % scrollHeight;
+  scrollStartPending = true;
+}
+
+uint16_t scroll_row(const uint16_t row) {
+  if (scrollHeight == 0)
+    return scrollTop + row;
+  return scrollTop + (scrollOffset + row) % scrollHeight;
+}
+
+static void lcd_apply_scroll() {
+  if (scrollAreaPending) {
+    uint16_t bottom = DISPLAY_HEIGHT - scrollTop - scrollHeight;
+    const uint8_t area[6] = {
+      (uint8_t)(scrollTop >> 8), (uint8_t)(scrollTop & 0xFF),
+      (uint8_t)(scrollHeight >> 8), (uint8_t)(scrollHeight & 0xFF),
+      (uint8_t)(bottom >> 8), (uint8_t)(bottom & 0xFF) };
+    lcd_command(ILI9341_VSCRDEF);
+    lcd_data(area, 6);
+    scrollAreaPending = false;
+  }
+  if (scrollStartPending) {
+    uint16_t start = scrollTop + scrollOffset;
+    const uint8_t line[2] = { (uint8_t)(start >> 8), (uint8_t)(start & 0xFF) };
+    lcd_command(ILI9341_VSCRSADD);
+    lcd_data(line, 2);
+    scrollStartPending = false;
+  }
+  lcd_bus->wait();
+}
+
+void shift_vram_left(const uint16_t x, const uint16_t y, const uint16_t width, const uint16_t height, const uint16_t dx) {
+  int xe = MIN(DISPLAY_WIDTH, x + width),
+    ye = MIN(DISPLAY_HEIGHT, y + height);
+  if (x + dx >= xe || y >= ye)
+    return;
+  vram_layout::shift_left(vram, x, y, xe - x, ye - y, dx);
+  mark_dirty(x, y, xe - x - dx, ye - y);
 }
 
 void display_vram() {
 	ili9341_write_frame(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, (const uint8_t *)vram);
+	numDirtyRects = 0;
+#if CONFIG_VRAM_TILE_HASH
+	rehash_all_tiles();
+#endif
+	lcd_apply_scroll();
+}
+
+void flush_vram() {
+#if CONFIG_VRAM_TILE_HASH
+	flush_changed_tiles();
+#else
+	blit_rects(dirtyRects, numDirtyRects);
+#endif
+	numDirtyRects = 0;
+	lcd_apply_scroll();
 }
 
 void blit_vram(const uint16_t xs, const uint16_t ys, const uint16_t width, const uint16_t height) {
-    int x, y;
-    int i;
-    uint16_t x1, y1;
-    uint32_t xv, yv, dc;
-    uint32_t temp[16];
-    dc = (1 << PIN_NUM_DC);
-
-    for (y=0; y<height; y++) {
-        //start line
-        x1 = xs+(width-1);
-        y1 = ys+y+(height-1);
-        xv = U16x2toU32(xs,x1);
-        yv = U16x2toU32((ys+y),y1);
-
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1tc = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), 0x2A);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1ts = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 31, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), xv);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1tc = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), 0x2B);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1ts = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 31, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), yv);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1tc = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), 0x2C);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-
-        x = 0;
-        GPIO.out_w1ts = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 511, SPI_USR_MOSI_DBITLEN_S);
-        while (x<width) {
-            for (i=0; i<16; i++) {
-                x1 = myPalette[(unsigned char)(vram[y + x * DISPLAY_HEIGHT])]; x++;
-                y1 = myPalette[(unsigned char)(vram[y + x * DISPLAY_HEIGHT])]; x++;
-                temp[i] = U16x2toU32(x1,y1);
-            }
-            while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-            for (i=0; i<16; i++) {
-                WRITE_PERI_REG((SPI_W0_REG(SPI_NUM) + (i << 2)), temp[i]);
-            }
-            SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        }
+    const rect_s rect = { xs, ys, width, height };
+    blit_vram(&rect, 1);
+}
+
+void blit_vram(const rect_s *rects, const int count) {
+#if CONFIG_VRAM_TILE_HASH
+    // partially sent tiles no longer match their hash, so resend them next flush
+    for (int i=0; i<count; i++)
+        invalidate_tiles(rects[i]);
+#endif
+    blit_rects(rects, count);
+}
+
+// Each rect is clipped to the screen and gets one window; the bus is only
+// drained after the last one, so the windows go out back to back.
+static void blit_rects(const rect_s *rects, const int count) {
+    int i, xe, ye;
+    for (i=0; i<count; i++) {
+        xe = MIN(rects[i].x + rects[i].width, DISPLAY_WIDTH);
+        ye = MIN(rects[i].y + rects[i].height, DISPLAY_HEIGHT);
+        if (rects[i].x >= xe || rects[i].y >= ye)
+            continue;
+        lcd_write_window(rects[i].x, rects[i].y, xe - rects[i].x, ye - rects[i].y, vram);
     }
-    while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
+    lcd_bus->wait();
 }
 
 // LOCAL ONLY FUNCTIONS
 
-static void spi_write_byte(const uint8_t data){
-    SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 0x7, SPI_USR_MOSI_DBITLEN_S);
-    WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), data);
-    SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-    while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
+static void lcd_command(const uint8_t cmd) {
+    lcd_stats.transactions++;
+    lcd_stats.command_bytes++;
+    lcd_bus->write_command(cmd);
+}
+
+static void lcd_data(const uint8_t *data, const uint32_t len) {
+    lcd_stats.transactions++;
+    lcd_stats.data_bytes += len;
+    lcd_bus->write_data(data, len);
+}
+
+static void lcd_pixels(const uint32_t *words, const int num_pixels) {
+    lcd_stats.transactions++;
+    lcd_stats.data_bytes += num_pixels * 2;
+    lcd_bus->write_pixels(words, num_pixels);
 }
 
 static void LCD_WriteCommand(const uint8_t cmd)
 {
-    LCD_SEL_CMD();
-    spi_write_byte(cmd);
+    lcd_command(cmd);
 }
 
 static void LCD_WriteData(const uint8_t data)
 {
-    LCD_SEL_DATA();
-    spi_write_byte(data);
+    lcd_data(&data, 1);
 }
 
 static void  ILI9341_INITIAL ()
 {
-    LCD_BKG_ON();
     //------------------------------------Reset Sequence-----------------------------------------//
-
-    LCD_RST_SET();
-    ets_delay_us(100000);                                                              
-
-    LCD_RST_CLR();
-    ets_delay_us(200000);                                                              
-
-    LCD_RST_SET();
-    ets_delay_us(200000);                                                             
+    lcd_bus->reset();
 
     //************* Start Initial Sequence **********//
     LCD_WriteCommand(0xCF);
@@ -440,7 +652,7 @@ static void  ILI9341_INITIAL ()
     LCD_WriteCommand(0xC7);    //VCM control2
     LCD_WriteData(0xBE); //i   //»òÕß B1h
 
-    LCD_WriteCommand(0x36);    // Memory Access Control
+    LCD_WriteCommand(ILI9341_MADCTL);    // Memory Access Control
     LCD_WriteData(0b01101000); // MY MX MV ML BGR MH 0 0, default 00
     //LCD_WriteData(0x28); //i //was 0x48
 
@@ -518,147 +730,82 @@ static void  ILI9341_INITIAL ()
     //LCD_WriteData(0x30);
 
     LCD_WriteCommand(0x11);    //Exit Sleep
-    ets_delay_us(100000);
+    lcd_bus->delay_us(100000);
     LCD_WriteCommand(0x29);    //Display on
-    ets_delay_us(100000);
+    lcd_bus->delay_us(100000);
 }
 //.............LCD API END----------
+//.............LCD API END----------
 
-static void ili_gpio_init()
-{
-#if CONFIG_LCD_USE_FAST_PINS
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO21_U,2);   //DC PIN
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO22_U,2);   //RESET PIN
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO25_U,2);   //BKL PIN
-    WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, BIT21|BIT22|BIT25);
-#else
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO21_U,2);   //DC PIN
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO18_U,2);   //RESET PIN
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO5_U,2);    //BKL PIN
-    WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, BIT21|BIT18|BIT5);
-#endif
+// sets the panel's address window to [xs,xe] x [ys,ye] and starts a memory write
+static void lcd_set_window(const uint16_t xs, const uint16_t ys, const uint16_t xe, const uint16_t ye) {
+    const uint8_t col[4] = { (uint8_t)(xs >> 8), (uint8_t)(xs & 0xFF), (uint8_t)(xe >> 8), (uint8_t)(xe & 0xFF) };
+    const uint8_t page[4] = { (uint8_t)(ys >> 8), (uint8_t)(ys & 0xFF), (uint8_t)(ye >> 8), (uint8_t)(ye & 0xFF) };
+    lcd_command(ILI9341_CASET);
+    lcd_data(col, 4);
+    lcd_command(ILI9341_PASET);
+    lcd_data(page, 4);
+    lcd_command(ILI9341_RAMWR);
 }
 
-static void spi_master_init()
-{
-    ets_printf("lcd spi pin mux init ...\r\n");
-#if CONFIG_LCD_USE_FAST_PINS
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO19_U,1);
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO23_U,1);
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO18_U,1);
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO5_U,1);
-#else
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO19_U,2);
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO23_U,2);
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO22_U,2);
-    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO25_U,2);
-    WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, BIT19|BIT23|BIT22);
-
-    ets_printf("lcd spi signal init\r\n");
-    gpio_matrix_in(PIN_NUM_MISO, VSPIQ_IN_IDX,0);
-    gpio_matrix_out(PIN_NUM_MOSI, VSPID_OUT_IDX,0,0);
-    gpio_matrix_out(PIN_NUM_CLK, VSPICLK_OUT_IDX,0,0);
-    gpio_matrix_out(PIN_NUM_CS, VSPICS0_OUT_IDX,0,0);
-#endif
-    ets_printf("Hspi config\r\n");
-
-    CLEAR_PERI_REG_MASK(SPI_SLAVE_REG(SPI_NUM), SPI_TRANS_DONE << 5);
-    SET_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_CS_SETUP);
-    CLEAR_PERI_REG_MASK(SPI_PIN_REG(SPI_NUM), SPI_CK_IDLE_EDGE);
-    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM),  SPI_CK_OUT_EDGE);
-    CLEAR_PERI_REG_MASK(SPI_CTRL_REG(SPI_NUM), SPI_WR_BIT_ORDER);
-    CLEAR_PERI_REG_MASK(SPI_CTRL_REG(SPI_NUM), SPI_RD_BIT_ORDER);
-    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_DOUTDIN);
-    WRITE_PERI_REG(SPI_USER1_REG(SPI_NUM), 0);
-    SET_PERI_REG_BITS(SPI_CTRL2_REG(SPI_NUM), SPI_MISO_DELAY_MODE, 0, SPI_MISO_DELAY_MODE_S);
-    CLEAR_PERI_REG_MASK(SPI_SLAVE_REG(SPI_NUM), SPI_SLAVE_MODE);
-    
-    WRITE_PERI_REG(SPI_CLOCK_REG(SPI_NUM), (1 << SPI_CLKCNT_N_S) | (1 << SPI_CLKCNT_L_S));//40MHz
-    //WRITE_PERI_REG(SPI_CLOCK_REG(SPI_NUM), SPI_CLK_EQU_SYSCLK); // 80Mhz
-    
-    SET_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_CS_SETUP | SPI_CS_HOLD | SPI_USR_MOSI);
-    SET_PERI_REG_MASK(SPI_CTRL2_REG(SPI_NUM), ((0x4 & SPI_MISO_DELAY_NUM) << SPI_MISO_DELAY_NUM_S));
-    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_COMMAND);
-    SET_PERI_REG_BITS(SPI_USER2_REG(SPI_NUM), SPI_USR_COMMAND_BITLEN, 0, SPI_USR_COMMAND_BITLEN_S);
-    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_ADDR);
-    SET_PERI_REG_BITS(SPI_USER1_REG(SPI_NUM), SPI_USR_ADDR_BITLEN, 0, SPI_USR_ADDR_BITLEN_S);
-    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_MISO);
-    SET_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_MOSI);
-    char i;
-    for (i = 0; i < 16; ++i) {
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM) + (i << 2)), 0);
+// Windows the panel once and streams width x height pixels out of the
+// full screen framebuffer fb (in the vram layout, or NULL for black).  The
+// panel wraps to the next row by itself, so pixels are packed continuously
+// across rows into full bursts instead of restarting the window per row.
+// Palette conversion alternates between the two scanout buffers so that
+// it overlaps with the bus sending the previous burst.  The last burst is
+// left in flight; callers drain the bus once they are done.
+static void lcd_write_window(const uint16_t xs, const uint16_t ys, const uint16_t width, const uint16_t height, const uint8_t *fb) {
+    int x, y, n, len, chunk, b;
+    uint16_t *buf;
+    if (width == 0 || height == 0)
+        return;
+    chunk = MIN(lcd_bus->max_pixels, LCD_PIXEL_BUF_LEN);
+    lcd_set_window(xs, ys, xs + width - 1, ys + height - 1);
+    b = 0;
+    // pixel i of a buffer is the (little endian) half word i
+    buf = (uint16_t *)lcd_pixel_buf[b];
+    n = 0;
+    for (y=ys; y<ys+height; y++) {
+        for (x=xs; x<xs+width; x+=len) {
+            len = MIN(xs + width - x, chunk - n);
+            if (fb == NULL)
+                memset(buf + n, 0, len * sizeof(uint16_t));
+            else
+                vram_layout::convert_span(fb, x, y, len, myPalette, buf + n);
+            n += len;
+            if (n == chunk) {
+                lcd_pixels((const uint32_t *)buf, n);
+                b ^= 1;
+                buf = (uint16_t *)lcd_pixel_buf[b];
+                n = 0;
+            }
+        }
     }
+    if (n > 0)
+        lcd_pixels((const uint32_t *)buf, n);
 }
 
+// data is a whole screen in the vram layout (or NULL to clear the window)
 void ili9341_write_frame(const uint16_t xs, const uint16_t ys, const uint16_t width, const uint16_t height, const uint8_t * data){
-    int x, y;
-    int i;
-    uint16_t x1, y1;
-    uint32_t xv, yv, dc;
-    uint32_t temp[16];
-    dc = (1 << PIN_NUM_DC);
-    
-    for (y=0; y<height; y++) {
-        //start line
-        x1 = xs+(width-1);
-        y1 = ys+y+(height-1);
-        xv = U16x2toU32(xs,x1);
-        yv = U16x2toU32((ys+y),y1);
-        
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1tc = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), 0x2A);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1ts = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 31, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), xv);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1tc = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), 0x2B);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1ts = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 31, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), yv);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        GPIO.out_w1tc = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 7, SPI_USR_MOSI_DBITLEN_S);
-        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), 0x2C);
-        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-        
-        x = 0;
-        GPIO.out_w1ts = dc;
-        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 511, SPI_USR_MOSI_DBITLEN_S);
-        while (x<width) {
-            for (i=0; i<16; i++) {
-                if(data == NULL){
-                    temp[i] = 0;
-                    x += 2;
-                    continue;
-                }
-                x1 = myPalette[(unsigned char)(data[y + x * height])]; x++;
-                y1 = myPalette[(unsigned char)(data[y + x * height])]; x++;
-                temp[i] = U16x2toU32(x1,y1);
-            }
-            while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
-            for (i=0; i<16; i++) {
-                WRITE_PERI_REG((SPI_W0_REG(SPI_NUM) + (i << 2)), temp[i]);
-            }
-            SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
-        }
-    }
-    while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
+    lcd_write_window(xs, ys, width, height, data);
+    lcd_bus->wait();
+}
+
+void lcd_set_bus(const lcd_bus_s *bus) {
+    lcd_bus = bus;
+}
+
+lcd_bus_stats_s lcd_get_bus_stats() {
+    return lcd_stats;
+}
+
+void lcd_reset_bus_stats() {
+    memset(&lcd_stats, 0, sizeof(lcd_stats));
 }
 
 void ili9341_init()
 {
-    spi_master_init();
-    ili_gpio_init();
+    lcd_bus->init();
     ILI9341_INITIAL ();
 }
@@ -0,0 +1,284 @@
+#include "LcdBus.hpp"
+#ifdef ESP_PLATFORM
+extern "C" {
+  #include <string.h>
+  #include <stdio.h>
+  #include "sdkconfig.h"
+  #include "rom/ets_sys.h"
+  #include "rom/gpio.h"
+  #include "soc/gpio_reg.h"
+  #include "soc/gpio_sig_map.h"
+  #include "soc/gpio_struct.h"
+  #include "soc/io_mux_reg.h"
+  #include "soc/spi_reg.h"
+  #include "freertos/FreeRTOS.h"
+  #include "freertos/task.h"
+  #include "driver/spi_master.h"
+}
+#include "Display.hpp"
+
+#define LCD_SEL_CMD()   GPIO.out_w1tc = (1 << LCD_PIN_DC) // Low to send command 
+#define LCD_SEL_DATA()  GPIO.out_w1ts = (1 << LCD_PIN_DC) // High to send data
+#define LCD_RST_SET()   GPIO.out_w1ts = (1 << LCD_PIN_RST) 
+#define LCD_RST_CLR()   GPIO.out_w1tc = (1 << LCD_PIN_RST)
+
+#ifdef CONFIG_WROVER_KIT_V1
+ #define LCD_BKG_ON()    GPIO.out_w1ts = (1 << LCD_PIN_BCKL) // Backlight ON
+ #define LCD_BKG_OFF()   GPIO.out_w1tc = (1 << LCD_PIN_BCKL) // Backlight OFF
+#else
+ #define LCD_BKG_ON()    GPIO.out_w1tc = (1 << LCD_PIN_BCKL) // Backlight ON
+ #define LCD_BKG_OFF()   GPIO.out_w1ts = (1 << LCD_PIN_BCKL) // Backlight OFF
+#endif
+
+#define SPI_NUM  0x3
+
+// LOCAL ONLY FUNCTIONS
+
+static void spi_wait() {
+    while (READ_PERI_REG(SPI_CMD_REG(SPI_NUM))&SPI_USR);
+}
+
+static void spi_write_byte(const uint8_t data){
+    SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, 0x7, SPI_USR_MOSI_DBITLEN_S);
+    WRITE_PERI_REG((SPI_W0_REG(SPI_NUM)), data);
+    SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
+    spi_wait();
+}
+
+static void ili_gpio_init()
+{
+#if CONFIG_LCD_USE_FAST_PINS
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO21_U,2);   //DC PIN
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO22_U,2);   //RESET PIN
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO25_U,2);   //BKL PIN
+    WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, BIT21|BIT22|BIT25);
+#else
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO21_U,2);   //DC PIN
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO18_U,2);   //RESET PIN
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO5_U,2);    //BKL PIN
+    WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, BIT21|BIT18|BIT5);
+#endif
+}
+
+static void spi_master_init()
+{
+    ets_printf("lcd spi pin mux init ...\r\n");
+#if CONFIG_LCD_USE_FAST_PINS
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO19_U,1);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO23_U,1);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO18_U,1);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO5_U,1);
+#else
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO19_U,2);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO23_U,2);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO22_U,2);
+    PIN_FUNC_SELECT(PERIPHS_IO_MUX_GPIO25_U,2);
+    WRITE_PERI_REG(GPIO_ENABLE_W1TS_REG, BIT19|BIT23|BIT22);
+
+    ets_printf("lcd spi signal init\r\n");
+    gpio_matrix_in(LCD_PIN_MISO, VSPIQ_IN_IDX,0);
+    gpio_matrix_out(LCD_PIN_MOSI, VSPID_OUT_IDX,0,0);
+    gpio_matrix_out(LCD_PIN_CLK, VSPICLK_OUT_IDX,0,0);
+    gpio_matrix_out(LCD_PIN_CS, VSPICS0_OUT_IDX,0,0);
+#endif
+    ets_printf("Hspi config\r\n");
+
+    CLEAR_PERI_REG_MASK(SPI_SLAVE_REG(SPI_NUM), SPI_TRANS_DONE << 5);
+    SET_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_CS_SETUP);
+    CLEAR_PERI_REG_MASK(SPI_PIN_REG(SPI_NUM), SPI_CK_IDLE_EDGE);
+    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM),  SPI_CK_OUT_EDGE);
+    CLEAR_PERI_REG_MASK(SPI_CTRL_REG(SPI_NUM), SPI_WR_BIT_ORDER);
+    CLEAR_PERI_REG_MASK(SPI_CTRL_REG(SPI_NUM), SPI_RD_BIT_ORDER);
+    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_DOUTDIN);
+    WRITE_PERI_REG(SPI_USER1_REG(SPI_NUM), 0);
+    SET_PERI_REG_BITS(SPI_CTRL2_REG(SPI_NUM), SPI_MISO_DELAY_MODE, 0, SPI_MISO_DELAY_MODE_S);
+    CLEAR_PERI_REG_MASK(SPI_SLAVE_REG(SPI_NUM), SPI_SLAVE_MODE);
+    
+    WRITE_PERI_REG(SPI_CLOCK_REG(SPI_NUM), (1 << SPI_CLKCNT_N_S) | (1 << SPI_CLKCNT_L_S));//40MHz
+    //WRITE_PERI_REG(SPI_CLOCK_REG(SPI_NUM), SPI_CLK_EQU_SYSCLK); // 80Mhz
+    
+    SET_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_CS_SETUP | SPI_CS_HOLD | SPI_USR_MOSI);
+    SET_PERI_REG_MASK(SPI_CTRL2_REG(SPI_NUM), ((0x4 & SPI_MISO_DELAY_NUM) << SPI_MISO_DELAY_NUM_S));
+    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_COMMAND);
+    SET_PERI_REG_BITS(SPI_USER2_REG(SPI_NUM), SPI_USR_COMMAND_BITLEN, 0, SPI_USR_COMMAND_BITLEN_S);
+    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_ADDR);
+    SET_PERI_REG_BITS(SPI_USER1_REG(SPI_NUM), SPI_USR_ADDR_BITLEN, 0, SPI_USR_ADDR_BITLEN_S);
+    CLEAR_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_MISO);
+    SET_PERI_REG_MASK(SPI_USER_REG(SPI_NUM), SPI_USR_MOSI);
+    char i;
+    for (i = 0; i < 16; ++i) {
+        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM) + (i << 2)), 0);
+    }
+}
+
+// BUS FUNCTIONS
+
+static void spi_bus_init() {
+    spi_master_init();
+    ili_gpio_init();
+}
+
+static void spi_bus_reset() {
+    LCD_BKG_ON();
+    LCD_RST_SET();
+    ets_delay_us(100000);
+    LCD_RST_CLR();
+    ets_delay_us(200000);
+    LCD_RST_SET();
+    ets_delay_us(200000);
+}
+
+static void spi_bus_delay_us(const uint32_t us) {
+    ets_delay_us(us);
+}
+
+static void spi_bus_write_command(const uint8_t cmd) {
+    spi_wait();
+    LCD_SEL_CMD();
+    spi_write_byte(cmd);
+}
+
+static void spi_bus_write_data(const uint8_t *data, const uint32_t len) {
+    uint32_t sent = 0, n;
+    uint32_t temp[16];
+    spi_wait();
+    LCD_SEL_DATA();
+    while (sent < len) {
+        n = len - sent;
+        if (n > sizeof(temp)) n = sizeof(temp);
+        // W0 goes out least significant byte first
+        memcpy(temp, data + sent, n);
+        SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, n * 8 - 1, SPI_USR_MOSI_DBITLEN_S);
+        for (uint32_t i=0; i<(n + 3) / 4; i++) {
+            WRITE_PERI_REG((SPI_W0_REG(SPI_NUM) + (i << 2)), temp[i]);
+        }
+        SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
+        spi_wait();
+        sent += n;
+    }
+}
+
+static void spi_bus_write_pixels(const uint32_t *words, const int num_pixels) {
+    int i;
+    spi_wait();
+    LCD_SEL_DATA();
+    SET_PERI_REG_BITS(SPI_MOSI_DLEN_REG(SPI_NUM), SPI_USR_MOSI_DBITLEN, num_pixels * 16 - 1, SPI_USR_MOSI_DBITLEN_S);
+    for (i=0; i<(num_pixels + 1) / 2; i++) {
+        WRITE_PERI_REG((SPI_W0_REG(SPI_NUM) + (i << 2)), words[i]);
+    }
+    // don't wait here, the caller fills its other buffer meanwhile
+    SET_PERI_REG_MASK(SPI_CMD_REG(SPI_NUM), SPI_USR);
+}
+
+const lcd_bus_s lcd_spi_bus = {
+    spi_bus_init,
+    spi_bus_reset,
+    spi_bus_delay_us,
+    spi_bus_write_command,
+    spi_bus_write_data,
+    spi_bus_write_pixels,
+    spi_wait,
+    32
+};
+
+// DMA BUS FUNCTIONS
+// Uses the IDF spi_master driver so pixel bursts go out by DMA.  At most
+// two pixel transactions are in flight: the one on the wire and the one
+// queued behind it.  Queueing a burst retires the one before it, which
+// hands that buffer back to the caller to be refilled.
+
+static spi_device_handle_t dma_spi;
+static spi_transaction_t   dma_trans[2];
+static int                 dma_next_trans = 0;
+static int                 dma_in_flight = 0;
+
+// runs in the SPI ISR right before a transaction starts; user is non-NULL for data
+static void IRAM_ATTR dma_pre_transfer_cb(spi_transaction_t *t) {
+    if (t->user != NULL) LCD_SEL_DATA();
+    else              LCD_SEL_CMD();
+}
+
+static void dma_retire_one() {
+    spi_transaction_t *done;
+    spi_device_get_trans_result(dma_spi, &done, portMAX_DELAY);
+    dma_in_flight--;
+}
+
+static void dma_bus_wait() {
+    while (dma_in_flight > 0)
+        dma_retire_one();
+}
+
+static void dma_bus_init() {
+    ili_gpio_init();
+
+    spi_bus_config_t buscfg;
+    memset(&buscfg, 0, sizeof(buscfg));
+    buscfg.miso_io_num = LCD_PIN_MISO;
+    buscfg.mosi_io_num = LCD_PIN_MOSI;
+    buscfg.sclk_io_num = LCD_PIN_CLK;
+    buscfg.quadwp_io_num = -1;
+    buscfg.quadhd_io_num = -1;
+    buscfg.max_transfer_sz = LCD_PIXEL_BUF_LEN * 2;
+
+    spi_device_interface_config_t devcfg;
+    memset(&devcfg, 0, sizeof(devcfg));
+    devcfg.clock_speed_hz = 40000000;
+    devcfg.mode = 0;
+    devcfg.spics_io_num = LCD_PIN_CS;
+    devcfg.queue_size = 4;
+    devcfg.pre_cb = dma_pre_transfer_cb;
+
+    ESP_ERROR_CHECK( spi_bus_initialize(VSPI_HOST, &buscfg, 1) );
+    ESP_ERROR_CHECK( spi_bus_add_device(VSPI_HOST, &devcfg, &dma_spi) );
+}
+
+// commands and parameters are tiny, so they go out blocking
+static void dma_bus_transmit(const uint8_t *data, const uint32_t len, const int dc) {
+    spi_transaction_t t;
+    dma_bus_wait();
+    memset(&t, 0, sizeof(t));
+    t.length = len * 8;
+    t.user = dc ? (void*)1 : NULL;
+    if (len <= 4) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t.tx_data, data, len);
+    }
+    else
+        t.tx_buffer = data;
+    spi_device_transmit(dma_spi, &t);
+}
+
+static void dma_bus_write_command(const uint8_t cmd) {
+    dma_bus_transmit(&cmd, 1, 0);
+}
+
+static void dma_bus_write_data(const uint8_t *data, const uint32_t len) {
+    dma_bus_transmit(data, len, 1);
+}
+
+static void dma_bus_write_pixels(const uint32_t *words, const int num_pixels) {
+    spi_transaction_t *t = &dma_trans[dma_next_trans];
+    dma_next_trans ^= 1;
+    memset(t, 0, sizeof(*t));
+    t->length = num_pixels * 16;
+    t->tx_buffer = words;
+    t->user = (void*)1;
+    spi_device_queue_trans(dma_spi, t, portMAX_DELAY);
+    dma_in_flight++;
+    if (dma_in_flight > 1)
+        dma_retire_one();
+}
+
+const lcd_bus_s lcd_spi_dma_bus = {
+    dma_bus_init,
+    spi_bus_reset,
+    spi_bus_delay_us,
+    dma_bus_write_command,
+    dma_bus_write_data,
+    dma_bus_write_pixels,
+    dma_bus_wait,
+    LCD_PIXEL_BUF_LEN
+};
+
+#endif // ESP_PLATFORM
@@ -1,6 +1,7 @@
 #ifndef DISPLAY_INCLUDE_GUARD_
 #define DISPLAY_INCLUDE_GUARD_
 #include <stdint.h>
+#include "LcdBus.hpp"
 
 //*****************************************************************************
 //
@@ -10,6 +11,32 @@
 
 #define CONFIG_WROVER_KIT_V2        1
 #define CONFIG_LCD_USE_FAST_PINS    0
+#define CONFIG_LCD_USE_DMA          1
+#ifndef CONFIG_VRAM_LAYOUT
+#define CONFIG_VRAM_LAYOUT          VRAM_LAYOUT_COLUMN_MAJOR // see VramLayout.hpp
+#endif
+#ifndef CONFIG_VRAM_TILE_HASH
+#define CONFIG_VRAM_TILE_HASH       1 // skip damaged tiles whose pixels did not change
+#endif
+
+// GPIOs wired to the LCD, other components must keep off them
+#if CONFIG_LCD_USE_FAST_PINS
+#define LCD_PIN_MISO 19
+#define LCD_PIN_MOSI 23
+#define LCD_PIN_CLK  18
+#define LCD_PIN_CS   5
+#define LCD_PIN_DC   21
+#define LCD_PIN_RST  22
+#define LCD_PIN_BCKL 25
+#else
+#define LCD_PIN_MISO 25
+#define LCD_PIN_MOSI 23
+#define LCD_PIN_CLK  19
+#define LCD_PIN_CS   22
+#define LCD_PIN_DC   21
+#define LCD_PIN_RST  18
+#define LCD_PIN_BCKL 5
+#endif
 
 #define DISPLAY_WIDTH  240
 #define DISPLAY_HEIGHT 320
@@ -19,11 +46,26 @@ typedef struct s_point_s {
   uint16_t y;
 } point_s;
 
-extern uint8_t  vram[];
+typedef struct s_rect_s {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+} rect_s;
+
+// max number of separate damaged regions tracked between flushes;
+// once full, new damage is merged into the closest existing region
+#define MAX_DIRTY_RECTS 16
+
+extern uint8_t  vram[]; // addressed through the layout in VramLayout.hpp
 extern uint16_t myPalette[];
 
 // low level screen functions
 void ili9341_init();
+void lcd_set_bus(
+  const lcd_bus_s *bus);
+lcd_bus_stats_s lcd_get_bus_stats();
+void lcd_reset_bus_stats();
 
 // VRAM functions
 void clear_vram();
@@ -33,13 +75,43 @@ void clear_vram(
   const uint16_t width,
   const uint16_t height);
 void display_vram();
+void shift_vram_left( // exposed columns on the right are left as they were
+  const uint16_t x,
+  const uint16_t y,
+  const uint16_t width,
+  const uint16_t height,
+  const uint16_t dx);
 void blit_vram(
   const uint16_t x,
   const uint16_t y,
   const uint16_t width,
   const uint16_t height);
+void blit_vram(
+  const rect_s*  rects,
+  const int      count);
+
+// damage tracking functions
+void mark_dirty(
+  int x,
+  int y,
+  int width,
+  int height);
+void mark_all_dirty();
+int  get_dirty_rects(
+  const rect_s** rects);
+void flush_vram(); // sends only the damaged (and, with tile hashing, changed) regions of vram
+
+// hardware scrolling functions (applied on the next flush)
+void set_scroll_area(
+  const uint16_t top,
+  const uint16_t height);
+void scroll_area(
+  const uint16_t lines);
+uint16_t scroll_row(
+  const uint16_t row);
 
 // text functions
+#define FONT_8X12_ADVANCE 9 // pixels from one 8x12 character to the next
 void Draw_8x12_char(
   char* _char_matrix,
   int x_start,
@@ -79,4 +151,10 @@ void draw_line(
   const point_s start,
   const point_s end,
   const uint8_t color);
+void draw_line( // the same pixels as above, only those in columns xMin..xMax
+  const point_s  start,
+  const point_s  end,
+  const uint8_t  color,
+  const uint16_t xMin,
+  const uint16_t xMax);
 #endif //DISPLAY_INCLUDE_GUARD_
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef LCDBUS_INCLUDE_GUARD_
+#define LCDBUS_INCLUDE_GUARD_
+#include <stdint.h>
+
+// ILI9341 commands used by the scanout and scrolling
+#define ILI9341_CASET    0x2A // column address set
+#define ILI9341_MADCTL   0x36 // memory access control
+#define ILI9341_PASET    0x2B // page address set
+#define ILI9341_RAMWR    0x2C // memory write
+#define ILI9341_VSCRDEF  0x33 // vertical scrolling definition
+#define ILI9341_VSCRSADD 0x37 // vertical scrolling start address
+
+// The transport the display code talks to.  Display.cpp only windows the
+// panel and streams pixels through these calls, so the same scanout runs
+// against the ESP32 SPI peripheral or against a mock on a host build.
+typedef struct s_lcd_bus_s {
+  void (*init)(void);                    // pins and SPI peripheral
+  void (*reset)(void);                   // backlight on + hardware reset
+  void (*delay_us)(const uint32_t us);
+  void (*write_command)(const uint8_t cmd);
+  void (*write_data)(const uint8_t *data, const uint32_t len);
+  // pixels are RGB565 already in wire byte order, two per word.  The call
+  // may return while the burst is still going out, so words must stay
+  // untouched until the next bus call returns; callers alternate between
+  // two buffers to fill one while the other is sent.
+  void (*write_pixels)(const uint32_t *words, const int num_pixels);
+  void (*wait)(void);                    // blocks until the bus is idle
+  int  max_pixels;                       // most pixels per write_pixels
+} lcd_bus_s;
+
+typedef struct s_lcd_bus_stats_s {
+  uint32_t transactions;
+  uint32_t command_bytes;
+  uint32_t data_bytes;
+} lcd_bus_stats_s;
+
+// size (in pixels) of each of the two RGB565 scanout buffers
+#define LCD_PIXEL_BUF_LEN (8 * 240)
+
+#ifdef ESP_PLATFORM
+// register level SPI master on VSPI, one 64 byte W0..W15 burst at a time
+extern const lcd_bus_s lcd_spi_bus;
+// spi_master driver on VSPI, whole pixel buffers sent by DMA
+extern const lcd_bus_s lcd_spi_dma_bus;
+#endif
+
+#endif //LCDBUS_INCLUDE_GUARD_
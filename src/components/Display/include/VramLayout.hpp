@@ -0,0 +1,181 @@
+#ifndef VRAMLAYOUT_INCLUDE_GUARD_
+#define VRAMLAYOUT_INCLUDE_GUARD_
+#include <stdint.h>
+#include <string.h>
+#include "Display.hpp"
+
+// Memory layouts for vram, selected with CONFIG_VRAM_LAYOUT.  Each layout
+// is a specialization of VramLayout<> providing the pixel addressing plus
+// the span operations the primitives and the scanout are built from, so
+// every caller is compiled against the chosen layout with no runtime
+// dispatch.
+#define VRAM_LAYOUT_COLUMN_MAJOR 0 // vram[y + x * DISPLAY_HEIGHT]
+#define VRAM_LAYOUT_ROW_MAJOR    1 // vram[x + y * DISPLAY_WIDTH]
+#define VRAM_LAYOUT_TILED_8X8    2 // 8x8 tiles in rows, pixels in rows within a tile
+
+#define VRAM_TILE_SIZE 8
+
+static inline uint16_t vram_swap16(const uint16_t c) {
+  return (c >> 8) | (c << 8);
+}
+
+static inline uint32_t vram_hash_mix(uint32_t h, const uint32_t w) {
+  h = (h + w) * 0x9E3779B1;
+  return h ^ (h >> 15);
+}
+
+template <int Layout> struct VramLayout;
+
+template <> struct VramLayout<VRAM_LAYOUT_COLUMN_MAJOR> {
+  static inline uint32_t index(const int x, const int y) {
+    return y + x * DISPLAY_HEIGHT;
+  }
+
+  static inline void fill_span(uint8_t *fb, const int x, const int y, const int len, const uint8_t c) {
+    uint8_t *p = fb + index(x, y);
+    for (int i=0; i<len; i++, p += DISPLAY_HEIGHT)
+      *p = c;
+  }
+
+  static inline void fill_rect(uint8_t *fb, const int x, const int y, const int w, const int h, const uint8_t c) {
+    for (int i=x; i<x+w; i++)
+      memset(fb + index(i, y), c, h);
+  }
+
+  // moves the w x h block at x,y left by dx, columns are contiguous so
+  // this is one copy per column
+  static inline void shift_left(uint8_t *fb, const int x, const int y, const int w, const int h, const int dx) {
+    for (int i=x; i<x+w-dx; i++)
+      memcpy(fb + index(i, y), fb + index(i + dx, y), h);
+  }
+
+  // palette converts len pixels of row y starting at x into out, in wire byte order
+  static inline void convert_span(const uint8_t *fb, const int x, const int y, const int len, const uint16_t *palette, uint16_t *out) {
+    const uint8_t *p = fb + index(x, y);
+    for (int i=0; i<len; i++, p += DISPLAY_HEIGHT)
+      out[i] = vram_swap16(palette[*p]);
+  }
+
+  // hashes a w x h block, x and y must be multiples of 8 and 4
+  static inline uint32_t hash_rect(const uint8_t *fb, const int x, const int y, const int w, const int h) {
+    uint32_t hash = 0;
+    for (int i=x; i<x+w; i++) {
+      const uint32_t *p = (const uint32_t *)(fb + index(i, y));
+      for (int j=0; j<h/4; j++)
+        hash = vram_hash_mix(hash, p[j]);
+    }
+    return hash;
+  }
+};
+
+template <> struct VramLayout<VRAM_LAYOUT_ROW_MAJOR> {
+  static inline uint32_t index(const int x, const int y) {
+    return x + y * DISPLAY_WIDTH;
+  }
+
+  static inline void fill_span(uint8_t *fb, const int x, const int y, const int len, const uint8_t c) {
+    memset(fb + index(x, y), c, len);
+  }
+
+  static inline void fill_rect(uint8_t *fb, const int x, const int y, const int w, const int h, const uint8_t c) {
+    for (int j=y; j<y+h; j++)
+      memset(fb + index(x, j), c, w);
+  }
+
+  static inline void shift_left(uint8_t *fb, const int x, const int y, const int w, const int h, const int dx) {
+    for (int j=y; j<y+h; j++)
+      memmove(fb + index(x, j), fb + index(x + dx, j), w - dx);
+  }
+
+  static inline void convert_span(const uint8_t *fb, const int x, const int y, int len, const uint16_t *palette, uint16_t *out) {
+    const uint8_t *p = fb + index(x, y);
+    while (len > 0 && ((uintptr_t)p & 3)) {
+      *out++ = vram_swap16(palette[*p++]);
+      len--;
+    }
+    // rows are contiguous, so read four pixels per load once aligned
+    const uint32_t *w = (const uint32_t *)p;
+    for (; len >= 4; len -= 4) {
+      uint32_t v = *w++;
+      out[0] = vram_swap16(palette[v & 0xFF]);
+      out[1] = vram_swap16(palette[(v >> 8) & 0xFF]);
+      out[2] = vram_swap16(palette[(v >> 16) & 0xFF]);
+      out[3] = vram_swap16(palette[v >> 24]);
+      out += 4;
+    }
+    p = (const uint8_t *)w;
+    while (len-- > 0)
+      *out++ = vram_swap16(palette[*p++]);
+  }
+
+  static inline uint32_t hash_rect(const uint8_t *fb, const int x, const int y, const int w, const int h) {
+    uint32_t hash = 0;
+    for (int j=y; j<y+h; j++) {
+      const uint32_t *p = (const uint32_t *)(fb + index(x, j));
+      for (int i=0; i<w/4; i++)
+        hash = vram_hash_mix(hash, p[i]);
+    }
+    return hash;
+  }
+};
+
+template <> struct VramLayout<VRAM_LAYOUT_TILED_8X8> {
+  static const int tilesPerRow = DISPLAY_WIDTH / VRAM_TILE_SIZE;
+
+  static inline uint32_t index(const int x, const int y) {
+    return
+      ((y / VRAM_TILE_SIZE) * tilesPerRow + (x / VRAM_TILE_SIZE)) * (VRAM_TILE_SIZE * VRAM_TILE_SIZE) +
+      (y % VRAM_TILE_SIZE) * VRAM_TILE_SIZE + (x % VRAM_TILE_SIZE);
+  }
+
+  // each tile row is 8 contiguous bytes, so spans go a tile at a time
+  static inline void fill_span(uint8_t *fb, int x, const int y, int len, const uint8_t c) {
+    while (len > 0) {
+      int n = VRAM_TILE_SIZE - (x % VRAM_TILE_SIZE);
+      if (n > len) n = len;
+      memset(fb + index(x, y), c, n);
+      x += n;
+      len -= n;
+    }
+  }
+
+  static inline void fill_rect(uint8_t *fb, const int x, const int y, const int w, const int h, const uint8_t c) {
+    for (int j=y; j<y+h; j++)
+      fill_span(fb, x, j, w, c);
+  }
+
+  // rows are split across tiles, copying left to right never reads a moved pixel
+  static inline void shift_left(uint8_t *fb, const int x, const int y, const int w, const int h, const int dx) {
+    for (int j=y; j<y+h; j++)
+      for (int i=x; i<x+w-dx; i++)
+        fb[index(i, j)] = fb[index(i + dx, j)];
+  }
+
+  static inline void convert_span(const uint8_t *fb, int x, const int y, int len, const uint16_t *palette, uint16_t *out) {
+    while (len > 0) {
+      int n = VRAM_TILE_SIZE - (x % VRAM_TILE_SIZE);
+      if (n > len) n = len;
+      const uint8_t *p = fb + index(x, y);
+      for (int i=0; i<n; i++)
+        *out++ = vram_swap16(palette[p[i]]);
+      x += n;
+      len -= n;
+    }
+  }
+
+  static inline uint32_t hash_rect(const uint8_t *fb, const int x, const int y, const int w, const int h) {
+    uint32_t hash = 0;
+    for (int j=y; j<y+h; j++) {
+      for (int i=x; i<x+w; i+=VRAM_TILE_SIZE) {
+        const uint32_t *p = (const uint32_t *)(fb + index(i, j));
+        hash = vram_hash_mix(hash, p[0]);
+        hash = vram_hash_mix(hash, p[1]);
+      }
+    }
+    return hash;
+  }
+};
+
+typedef VramLayout<CONFIG_VRAM_LAYOUT> vram_layout;
+
+#endif //VRAMLAYOUT_INCLUDE_GUARD_
@@ -0,0 +1,81 @@
+#include "BinaryDecoder.hpp"
+
+namespace DisplayTask {
+
+  using namespace BinaryProtocol;
+
+  void BinaryDecoder::begin( StrView frame ) {
+    const uint8_t* p = (const uint8_t*) frame.data;
+    _pos = p + header;
+    _end = p + frame.len;
+    _count = 0;
+    _stats.frames++;
+    if ( frame.len < header || frame.len != header + p[2] ) {
+      bad();
+      return;
+    }
+    if ( p[1] == BINARY_REGISTER ) {
+      uint32_t id;
+      int n = getVarint( _pos, _end, id );
+      int nameLen = _end - _pos - n;
+      if ( n == 0 || id >= BINARY_MAX_SERIES || nameLen > BINARY_MAX_NAME ) {
+        bad();
+        return;
+      }
+      Series& s = _series[id];
+      memcpy( s.name, _pos + n, nameLen );
+      s.nameLen = nameLen;
+      s.registered = true;
+      s.last = 0;
+      s.plot = -1;
+      _stats.registrations++;
+      _pos = _end;
+    }
+    else if ( p[1] != BINARY_SAMPLES ) {
+      bad();
+    }
+  }
+
+  bool BinaryDecoder::next( int& series, int& value ) {
+    while ( true ) {
+      if ( _count == 0 ) {
+        // start of the next group
+        if ( _pos >= _end )
+          return false;
+        uint32_t id;
+        int n = getVarint( _pos, _end, id );
+        if ( n == 0 || id >= BINARY_MAX_SERIES || _pos + n >= _end )
+          return bad();
+        _pos += n;
+        _id = id;
+        _count = *_pos++;
+        continue;
+      }
+      uint32_t delta;
+      int n = getVarint( _pos, _end, delta );
+      if ( n == 0 )
+        return bad();
+      _pos += n;
+      _count--;
+      Series& s = _series[_id];
+      if ( !s.registered ) {
+        // the deltas have no base, skip them
+        _stats.unknownSeries++;
+        continue;
+      }
+      s.last = (int32_t) ((uint32_t) s.last + (uint32_t) unzigzag( delta ));
+      series = _id;
+      value = s.last;
+      _stats.samples++;
+      return true;
+    }
+  }
+
+  bool BinaryDecoder::bad( void ) {
+    _stats.badFrames++;
+    _pos = _end;
+    _count = 0;
+    return false;
+  }
+
+};
@@ -0,0 +1,63 @@
+#include "DatagramPool.hpp"
+
+namespace DisplayTask {
+
+  static_assert( (UDP_POOL_BUFFERS & (UDP_POOL_BUFFERS - 1)) == 0,
+                 "UDP_POOL_BUFFERS must be a power of two" );
+  static_assert( UDP_MAX_SOURCES <= 256, "sender slots must fit a tag's low byte" );
+
+  char* DatagramPool::acquire( void ) {
+    uint32_t head = _head.load( std::memory_order_relaxed );
+    uint32_t tail = _tail.load( std::memory_order_acquire );
+    if ( head - tail == count ) {
+      _stats.empty++;
+      return nullptr;
+    }
+    return _buffers[ head & (count - 1) ].data;
+  }
+
+  void DatagramPool::submit( int len, uint32_t stamp, uint32_t tag ) {
+    if ( len <= 0 )
+      return;
+    uint32_t head = _head.load( std::memory_order_relaxed );
+    uint32_t tail = _tail.load( std::memory_order_acquire );
+    Buffer&  b    = _buffers[ head & (count - 1) ];
+    b.len   = len < bufferSize ? len : bufferSize;
+    b.stamp = stamp;
+    b.tag   = tag;
+    _head.store( ++head, std::memory_order_release );
+
+    _stats.datagrams++;
+    _stats.bytes += b.len;
+    if ( head - tail > _stats.highWater )
+      _stats.highWater = head - tail;
+  }
+
+  bool DatagramPool::peek( StrView& datagram, uint32_t* stamp, uint32_t* tag ) {
+    uint32_t tail = _tail.load( std::memory_order_relaxed );
+    uint32_t head = _head.load( std::memory_order_acquire );
+    if ( tail == head )
+      return false;
+    const Buffer& b = _buffers[ tail & (count - 1) ];
+    if ( stamp != nullptr )
+      *stamp = b.stamp;
+    if ( tag != nullptr )
+      *tag = b.tag;
+    datagram = StrView( b.data, b.len );
+    return true;
+  }
+
+  void DatagramPool::release( void ) {
+    _tail.store( _tail.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+  }
+
+  int DatagramPool::used( void ) const {
+    uint32_t tail = _tail.load( std::memory_order_acquire );
+    uint32_t head = _head.load( std::memory_order_acquire );
+    int bytes = 0;
+    for ( ; tail != head; tail++ )
+      bytes += _buffers[ tail & (count - 1) ].len;
+    return bytes;
+  }
+
+};
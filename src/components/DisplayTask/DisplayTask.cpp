@@ -1,9 +1,17 @@
 #include "DisplayTask.hpp"
 #include "sdkconfig.h"
+#include <climits>
+#include <cstdlib>
+#include <atomic>
+#include "esp_timer.h"
+#ifdef CONFIG_SPIRAM_SUPPORT
+#include "esp_heap_caps.h"
+#endif
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #define MS_TO_TICKS( xTimeInMs ) (uint32_t)( ( ( TickType_t ) xTimeInMs * configTICK_RATE_HZ ) / ( TickType_t ) 1000 )
+#define MS_TO_TICKS_CEIL( xTimeInMs ) (uint32_t)( ( ( TickType_t ) xTimeInMs * configTICK_RATE_HZ + 999 ) / ( TickType_t ) 1000 )
 
 namespace DisplayTask {
 
@@ -12,28 +20,106 @@ namespace DisplayTask {
   bool hasNewPlotData  = false;
   bool hasNewTextData  = false;
   // for sending data to the display
-  std::queue<std::string> qData;
-  SemaphoreHandle_t       qDataMutex = NULL;
+  IngestRing    ingestRings[ NUM_INGEST_RINGS ];
+  StreamFramer  ingestFramers[ NUM_INGEST_RINGS ];
+  BinaryDecoder binaryDecoders[ NUM_INGEST_RINGS ];
+  DatagramPool  datagramPool;
+  StreamFramer  udpFramers[ UDP_MAX_SOURCES ];
+  BinaryDecoder udpDecoders[ UDP_MAX_SOURCES ];
+  // generation of the sender each UDP slot's state belongs to
+  static uint32_t udpGenerations[ UDP_MAX_SOURCES ];
+  ParseStats parseStats = {};
+
+  DisplayStats displayStats = {};
+
+  static uint32_t now_us( void ) {
+    return (uint32_t) esp_timer_get_time();
+  }
 
-  void pushData ( std::string data ) {
-    if ( xSemaphoreTake( qDataMutex, ( TickType_t ) 100 ) == pdTRUE ) {
-      qData.push(data);
-      xSemaphoreGive( qDataMutex );
-    }
+  // set once the display task runs, producers notify it after each push
+  static TaskHandle_t displayTask = NULL;
+
+  bool pushData ( IngestSource source, const char* data, int len ) {
+    bool ok = ingestRings[ source ].push( data, len, now_us() );
+    if ( displayTask != NULL )
+      xTaskNotifyGive( displayTask );
+    return ok;
   }
 
-  std::string popData  ( void ) {
-    std::string retData = "";
-    if ( xSemaphoreTake( qDataMutex, ( TickType_t ) 100 ) == pdTRUE ) {
-      if (!qData.empty()) {
-        retData = qData.front();
-        qData.pop();
-      }
-      xSemaphoreGive( qDataMutex );
+  char* reserveData ( IngestSource source, int& len ) {
+    return ingestRings[ source ].reserve( len );
+  }
+
+  void commitData ( IngestSource source, int len ) {
+    ingestRings[ source ].commit( len, now_us() );
+    if ( displayTask != NULL )
+      xTaskNotifyGive( displayTask );
+  }
+
+  // The task that last found the pool used up, woken by the next release.
+  // It registers before it looks at the pool, and a release frees its
+  // buffer before it looks for a waiter, so one of the two always sees
+  // the other: either the receiver finds the buffer, or the display task
+  // finds the receiver to wake.
+  static std::atomic<TaskHandle_t> datagramWaiter( NULL );
+
+  char* acquireDatagram ( void ) {
+    datagramWaiter.store( xTaskGetCurrentTaskHandle() );
+    char* buffer = datagramPool.acquire();
+    if ( buffer != nullptr )
+      datagramWaiter.store( NULL );
+    return buffer;
+  }
+
+  void submitDatagram ( int len, uint32_t tag ) {
+    datagramPool.submit( len, now_us(), tag );
+    if ( displayTask != NULL )
+      xTaskNotifyGive( displayTask );
+  }
+
+  // The UDP source is read from the datagram pool, every other one from
+  // its ring.
+  static bool peekSource( int source, StrView& data, uint32_t* stamp, uint32_t* tag ) {
+    if ( source == INGEST_UDP )
+      return datagramPool.peek( data, stamp, tag );
+    return ingestRings[source].peek( data, stamp );
+  }
+
+  static void releaseSource( int source ) {
+    if ( source != INGEST_UDP ) {
+      ingestRings[source].release();
+      return;
     }
-    return retData;
+    datagramPool.release();
+    TaskHandle_t waiter = datagramWaiter.exchange( NULL );
+    if ( waiter != NULL )
+      xTaskNotifyGive( waiter );
+  }
+
+  static int sourceUsed( int source ) {
+    if ( source == INGEST_UDP )
+      return datagramPool.used();
+    return ingestRings[source].used();
+  }
+
+  static uint32_t lastFrame = 0;  // us
+
+  static bool frameDue( void ) {
+    return now_us() - lastFrame >= 1000000 / MAX_FRAME_RATE;
+  }
+
+  static uint32_t msUntilFrameDue( void ) {
+    uint32_t since = now_us() - lastFrame;
+    uint32_t period = 1000000 / MAX_FRAME_RATE;
+    return since >= period ? 0 : (period - since + 999) / 1000;
   }
 
+  // messages applied since the last frame was flushed
+  static uint32_t frameStart    = 0;
+  static uint32_t frameMessages = 0;
+  static int64_t  frameAgeSum   = 0;  // us, relative to frameStart
+  static int32_t  frameMaxAge   = 0;
+
   int graphHeight = DISPLAY_HEIGHT * 2 / 3;
   int debugHeight = DISPLAY_HEIGHT - graphHeight;
 
@@ -42,45 +128,180 @@ namespace DisplayTask {
 
   // Graph Display
 
-  void GraphDisplay::Plot::init( const std::string& newName ) {
+  // plot history goes to PSRAM when there is some
+  static void* allocHistory( size_t size ) {
+#ifdef CONFIG_SPIRAM_SUPPORT
+    void* p = heap_caps_malloc( size, MALLOC_CAP_SPIRAM );
+    if ( p != nullptr )
+      return p;
+#endif
+    return malloc( size );
+  }
+
+  bool GraphDisplay::Plot::init( const std::string& newName ) {
+    // the buffers are kept when a plot slot is reused
+    if ( data == nullptr )
+      data = (int*) allocHistory( PLOT_HISTORY_LEN * sizeof(int) );
+    if ( levels == nullptr )
+      levels = (Range*) allocHistory( (PLOT_HISTORY_LEN - 1) * sizeof(Range) );
+    if ( data == nullptr || levels == nullptr )
+      return false;
     name = newName;
     color = rand() % 256;
+    // plots start out as a flat line at 0 over the whole history
+    memset( data, 0, PLOT_HISTORY_LEN * sizeof(int) );
+    memset( levels, 0, (PLOT_HISTORY_LEN - 1) * sizeof(Range) );
+    seq = PLOT_HISTORY_LEN;
     range = 1;
+    yScale = 0;
     min = 0;
     max = 0;
-    memset( data, 0, MAX_PLOT_DATA_LEN );
+    pending = 0;
+    drawnMin = 0;
+    drawnMax = 0;
+    bin.count = 0;
+    binWidth = 1;
+    autoBin = true;
+    arrivals = 0;
+    return true;
   }
 
-  void GraphDisplay::Plot::update( void ) {
-    for (int i=0; i<MAX_PLOT_DATA_LEN; i++) {
-      if (data[i] > max)
-        max = data[i];
-      else if (data[i] < min)
-        min = data[i];
+  bool GraphDisplay::Plot::add( int sample ) {
+    arrivals++;
+    if ( bin.count == 0 ) {
+      bin.min = sample;
+      bin.max = sample;
+      bin.sum = 0;
+    }
+    else {
+      bin.min = std::min( bin.min, sample );
+      bin.max = std::max( bin.max, sample );
     }
-    range = max - min;
+    bin.last = sample;
+    bin.sum += sample;
+    bin.count++;
+    if ( bin.count < (uint32_t) binWidth )
+      return false;
+    shift( (int) (bin.sum / bin.count), bin.min, bin.max );
+    bin.count = 0;
+    return true;
+  }
+
+  void GraphDisplay::Plot::shift( int newData, int lo, int hi ) {
+    data[ seq & (PLOT_HISTORY_LEN - 1) ] = newData;
+    for (int l=1; l<=PLOT_HISTORY_BITS; l++) {
+      Range& block = level(l)[ (seq >> l) & ((PLOT_HISTORY_LEN >> l) - 1) ];
+      if ( (seq & ((1u << l) - 1)) == 0 ) {
+        // first sample of the block, the slot still holds the block
+        // PLOT_HISTORY_LEN samples back
+        block.min = lo;
+        block.max = hi;
+      }
+      else {
+        block.min = std::min( block.min, lo );
+        block.max = std::max( block.max, hi );
+      }
+    }
+    seq++;
+    pending++;
+  }
+
+  // splits [first, first + count) into the largest aligned blocks it holds
+  GraphDisplay::Range GraphDisplay::Plot::query( uint32_t first, uint32_t count ) const {
+    Range r = { INT_MAX, INT_MIN };
+    while ( count > 0 ) {
+      // as large as both the alignment of first and count allow
+      int l = std::min( 31 - __builtin_clz( count ), PLOT_HISTORY_BITS );
+      if ( first != 0 )
+        l = std::min( l, __builtin_ctz( first ) );
+      if ( l == 0 && (first & ~1u) + PLOT_HISTORY_LEN >= seq ) {
+        // A lone point's bin extremes are only kept in the block of the
+        // pair it belongs to, so it answers with the pair: at most one
+        // neighbour too wide, but never missing a spike.  The oldest
+        // point's pair block may already hold the newest point instead.
+        const Range& pair = level(1)[ (first >> 1) & ((PLOT_HISTORY_LEN >> 1) - 1) ];
+        r.min = std::min( r.min, pair.min );
+        r.max = std::max( r.max, pair.max );
+      }
+      else if ( l == 0 ) {
+        int v = at( first );
+        r.min = std::min( r.min, v );
+        r.max = std::max( r.max, v );
+      }
+      else {
+        const Range& block = level(l)[ (first >> l) & ((PLOT_HISTORY_LEN >> l) - 1) ];
+        r.min = std::min( r.min, block.min );
+        r.max = std::max( r.max, block.max );
+      }
+      first += 1u << l;
+      count -= 1u << l;
+    }
+    return r;
+  }
+
+  void GraphDisplay::Plot::scale( int span, int height ) {
+    Range r = query( seq - span, span );
+    min = r.min;
+    max = r.max;
+    range = (uint32_t) max - (uint32_t) min;
     if (range == 0) range = 1;
+    yScale = ((int64_t) height << 32) / range;
   }
 
-  void GraphDisplay::Plot::shift( int newData ) {
-    shift();
-    data[MAX_PLOT_DATA_LEN - 1] = newData;
-    update();
+  // Every sample drawn lies within [min, max], so the product stays
+  // below height * 2^32.
+  int GraphDisplay::valueY( GraphDisplay::Plot* plot, int value ) {
+    return bottom - (int) ((((int64_t) value - plot->min) * plot->yScale) >> 32);
   }
 
-  void GraphDisplay::Plot::shift( void ) {
-    for (int i=0; i<MAX_PLOT_DATA_LEN-1; i++)
-      data[i] = data[i + 1];
+  int GraphDisplay::plotY( GraphDisplay::Plot* plot, int i ) {
+    return valueY( plot, plot->at( plot->seq - _span + i ) );
+  }
+
+  void GraphDisplay::drawSegment( GraphDisplay::Plot* plot, int i, int xMin, int xMax ) {
+    draw_line(
+      { (uint16_t) (left + (i-1) * xStep()), (uint16_t) plotY( plot, i-1 ) },
+      { (uint16_t) (left + i * xStep()),     (uint16_t) plotY( plot, i ) },
+      plot->color, xMin, xMax);
   }
 
   void GraphDisplay::drawPlot( GraphDisplay::Plot* plot ) {
-    for (int i=1; i<MAX_PLOT_DATA_LEN; i++) {
-      draw_line(
-        { (uint16_t) (left+((i-1)*right)/MAX_PLOT_DATA_LEN),
-         (uint16_t) (bottom-((plot->data[i-1] - plot->min)*(bottom-top))/plot->range) },
-        { (uint16_t) (left+(i*right)/MAX_PLOT_DATA_LEN),
-         (uint16_t) (bottom-((plot->data[i] - plot->min)*(bottom-top))/plot->range) },
-        plot->color);
+    for (int i=1; i<_span; i++)
+      drawSegment( plot, i );
+  }
+
+  // Each pixel column covers span / columns samples and is drawn as one
+  // vertical line from their min to their max, so spikes are never lost.
+  // Columns are stretched to meet the previous one to keep the trace
+  // connected.
+  void GraphDisplay::drawColumns( GraphDisplay::Plot* plot ) {
+    int      columns = right - left;
+    uint32_t first   = plot->seq - _span;
+    int      prevTop = 0, prevBottom = 0;
+    for (int c=0; c<columns; c++) {
+      uint32_t s0 = first + (c * _span) / columns;
+      uint32_t s1 = first + ((c + 1) * _span) / columns;
+      Range r = plot->query( s0, s1 - s0 );
+      int yTop = valueY( plot, r.max ),
+        yBottom = valueY( plot, r.min );
+      int y0 = yTop, y1 = yBottom;
+      if ( c > 0 ) {
+        y0 = std::min( y0, prevBottom );
+        y1 = std::max( y1, prevTop );
+      }
+      draw_line( { (uint16_t) (left + c), (uint16_t) y0 },
+                 { (uint16_t) (left + c), (uint16_t) y1 },
+                 plot->color );
+      prevTop = yTop;
+      prevBottom = yBottom;
+    }
+  }
+
+  void GraphDisplay::setSpan( int samples ) {
+    samples = std::max( 2, std::min( samples, PLOT_HISTORY_LEN ) );
+    if ( samples != _span ) {
+      _span = samples;
+      _redraw = true;
     }
   }
 
@@ -92,59 +313,242 @@ namespace DisplayTask {
 
   void GraphDisplay::clearPlots( void ) {
     _numPlots = 0;
+    rebuildIndex();
+    _redraw = true;
   }
 
+  // The window can be scrolled instead of redrawn if every plot moved on
+  // by the same number of samples and kept the scale it was drawn with.
+  bool GraphDisplay::canScroll( int& steps ) {
+    if ( _redraw || _numPlots == 0 )
+      return false;
+    steps = _plots[0].pending;
+    for (int i=0; i<_numPlots; i++) {
+      Plot* plot = &_plots[i];
+      if ( plot->pending != steps ||
+           plot->min != plot->drawnMin || plot->max != plot->drawnMax )
+        return false;
+    }
+    return steps < _span - 1;
+  }
+
+  // Strip chart: the drawn plots are shifted left in vram by one x step
+  // per new sample and only the segments ending at the new samples are
+  // rasterized into the exposed strip.  The column of the newest old point
+  // and the first column are shared with segments that are not redrawn,
+  // or that scrolled off, so both are cleared and only their own column of
+  // the segments through them drawn again; every pixel then ends up the
+  // color a full redraw gives it.  Spans with more samples than pixels are
+  // redrawn as columns, which costs the same however long the span is.
   void GraphDisplay::drawPlots( void ) {
+    for (int i=0; i<_numPlots; i++)
+      _plots[i].scale( _span, bottom - top );
+    int steps = 0;
+    if ( columnMode() ) {
+      clear();
+      for (int i=0; i<_numPlots; i++)
+        drawColumns(&_plots[i]);
+    }
+    else if ( canScroll( steps ) ) {
+      if ( steps > 0 ) {
+        int plotWidth = (_span - 1) * xStep() + 1;
+        int dx = steps * xStep();
+        int joint = left + plotWidth - 1 - dx;
+        shift_vram_left( left, top, plotWidth, height(), dx );
+        clear_vram( joint, top, dx + 1, height() );
+        clear_vram( left, top, 1, height() );
+        for (int i=0; i<_numPlots; i++) {
+          drawSegment( &_plots[i], 1, left, left );
+          drawSegment( &_plots[i], _span-steps-1, joint, joint );
+          for (int j=_span-steps; j<_span; j++)
+            drawSegment( &_plots[i], j );
+        }
+      }
+    }
+    else {
+      clear();
+      for (int i=0; i<_numPlots; i++)
+        drawPlot(&_plots[i]);
+    }
     for (int i=0; i<_numPlots; i++) {
-      drawPlot(&_plots[i]);
+      _plots[i].pending = 0;
+      _plots[i].drawnMin = _plots[i].min;
+      _plots[i].drawnMax = _plots[i].max;
     }
+    _redraw = false;
   }
 
-  void GraphDisplay::addData( std::string& plotName, int newData ) {
-    int pi = getPlotIndex( plotName );
-    if ( pi == -1 )
-      pi = createPlot( plotName, true );
-    _plots[pi].shift( newData );
+  uint32_t GraphDisplay::hashName( StrView name ) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i=0; i<name.len; i++)
+      hash = (hash ^ (uint8_t) name.data[i]) * 16777619u;
+    return hash;
   }
 
-  int GraphDisplay::createPlot( std::string& plotName, bool overWrite ) {
-    int index = getPlotIndex( plotName );
+  int GraphDisplay::findSlot( StrView name, uint32_t hash ) {
+    int slot = hash & (indexSize - 1);
+    while ( _index[slot] != -1 ) {
+      if ( _indexHash[slot] == hash && name == _plots[ _index[slot] ].name )
+        break;
+      slot = (slot + 1) & (indexSize - 1);
+    }
+    return slot;
+  }
+
+  // needed whenever plots move between slots or change names
+  void GraphDisplay::rebuildIndex( void ) {
+    for (int i=0; i<indexSize; i++)
+      _index[i] = -1;
+    for (int i=0; i<_numPlots; i++) {
+      uint32_t hash = hashName( _plots[i].name );
+      int slot = findSlot( _plots[i].name, hash );
+      _index[slot] = i;
+      _indexHash[slot] = hash;
+    }
+    _generation++;
+  }
+
+  int GraphDisplay::plotId( StrView plotName, bool create ) {
+    int id = getPlotIndex( plotName );
+    if ( id == -1 && create )
+      id = createPlot( plotName, true );
+    return id;
+  }
+
+  bool GraphDisplay::addData( int id, int newData ) {
+    if ( id > -1 && id < _numPlots ) {
+      _plots[id].lastSample = _now;
+      return _plots[id].add( newData );
+    }
+    return false;
+  }
+
+  bool GraphDisplay::addData( StrView plotName, int newData ) {
+    return addData( plotId( plotName ), newData );
+  }
+
+  void GraphDisplay::setBinWidth( int id, int samples ) {
+    if ( id > -1 && id < _numPlots ) {
+      _plots[id].autoBin = samples <= 0;
+      _plots[id].binWidth = std::max( 1, samples );
+    }
+  }
+
+  // An automatic bin is made wide enough to keep the plot at or below
+  // PLOT_POINT_RATE points a second, in powers of two.  It only narrows
+  // once the rate is well below what the narrower bin could take, so a
+  // rate near a boundary does not flip it every window.
+  void GraphDisplay::updateRates( uint32_t nowUs ) {
+    _now = nowUs;
+    uint32_t elapsed = nowUs - _rateStart;
+    if ( elapsed < PLOT_RATE_WINDOW_MS * 1000 )
+      return;
+    for (int i=0; i<_numPlots; i++) {
+      Plot& plot = _plots[i];
+      if ( plot.autoBin ) {
+        uint32_t rate = (uint64_t) plot.arrivals * 1000000 / elapsed;
+        int width = pow2AtLeast( (rate + PLOT_POINT_RATE - 1) / PLOT_POINT_RATE );
+        if ( width > plot.binWidth )
+          plot.binWidth = width;
+        else if ( width < plot.binWidth &&
+                  rate * 4 < (uint32_t) (plot.binWidth / 2) * PLOT_POINT_RATE * 3 )
+          plot.binWidth = std::max( 1, plot.binWidth / 2 );
+      }
+      plot.arrivals = 0;
+    }
+    _rateStart = nowUs;
+  }
+
+  int GraphDisplay::createPlot( StrView plotName, bool overWrite ) {
+    uint32_t hash = hashName( plotName );
+    int slot = findSlot( plotName, hash );
+    int index = _index[slot];
+    std::string name( plotName.data, plotName.len );
     if (index > -1) {
       if ( overWrite ) {
         // will overwrite plot that has the same name with empty plot
-        _plots[index].init( plotName );
+        _plots[index].init( name );
+        _plots[index].lastSample = _now;
+        _redraw = true;
       }
       return index;
     }
     else {
       if ( _numPlots < MAX_PLOTS ) {
+        if ( !_plots[_numPlots].init( name ) )
+          return -1;
+        _plots[_numPlots].lastSample = _now;
         index = _numPlots++;
-        _plots[index].init( plotName );
+        _index[slot] = index;
+        _indexHash[slot] = hash;
+        _redraw = true;
         return index;
       }
-      else if ( overWrite ) {
-        index = 0;
-        _plots[index].init( plotName );
+      else if ( overWrite && (index = idlestPlot()) != -1 ) {
+        if ( !_plots[index].init( name ) )
+          return -1;
+        _plots[index].lastSample = _now;
+        displayStats.plotsEvicted++;
+        rebuildIndex();
+        _redraw = true;
         return index;
       }
     }
+    displayStats.plotsRejected++;
     return -1;
   }
 
-  void GraphDisplay::removePlot( std::string& plotName ) {
+  // The plot that has gone without samples the longest.  Plots still
+  // being fed are never given up for a new one, that is turned away.
+  // The clock wraps every 71 minutes, which at worst puts off an
+  // eviction by PLOT_IDLE_MS.
+  int GraphDisplay::idlestPlot( void ) {
+    int idlest = -1;
+    uint32_t longest = PLOT_IDLE_MS * 1000u;
+    for (int i=0; i<_numPlots; i++) {
+      uint32_t idle = _now - _plots[i].lastSample;
+      if ( idle >= longest ) {
+        idlest = i;
+        longest = idle;
+      }
+    }
+    return idlest;
+  }
+
+  void GraphDisplay::removePlot( StrView plotName ) {
     int index = getPlotIndex( plotName );
     removePlot( index );
   }
 
   void GraphDisplay::removePlot( int index ) {
-    if (index > -1) {
-      for (int i=index; i<_numPlots; i++)
-        _plots[i] = _plots[i+1];
+    if (index > -1 && index < _numPlots) {
+      // swapped rather than copied so each slot keeps its own history
+      for (int i=index; i<_numPlots-1; i++)
+        std::swap( _plots[i], _plots[i+1] );
       _numPlots--;
+      rebuildIndex();
+      _redraw = true;
     }
   }
 
-  GraphDisplay::Plot* GraphDisplay::getPlot( std::string& plotName ) {
+  void GraphDisplay::removePlots( StrView prefix ) {
+    int kept = 0;
+    for (int i=0; i<_numPlots; i++) {
+      if ( StrView( _plots[i].name ).startsWith( prefix ) )
+        continue;
+      if ( kept != i )
+        std::swap( _plots[kept], _plots[i] );
+      kept++;
+    }
+    if ( kept < _numPlots ) {
+      _numPlots = kept;
+      rebuildIndex();
+      _redraw = true;
+    }
+  }
+
+  GraphDisplay::Plot* GraphDisplay::getPlot( StrView plotName ) {
     int index = getPlotIndex( plotName );
     if (index > -1)
       return &_plots[index];
@@ -152,15 +556,11 @@ namespace DisplayTask {
       return nullptr;
   }
 
-  int GraphDisplay::getPlotIndex( std::string& plotName ) {
-    for (int i=0; i<_numPlots; i++) {
-      if (_plots[i].name == plotName )
-        return i;
-    }
-    return -1;
+  int GraphDisplay::getPlotIndex( StrView plotName ) {
+    return _index[ findSlot( plotName, hashName( plotName ) ) ];
   }
 
-  bool GraphDisplay::hasPlot( std::string& plotName ) {
+  bool GraphDisplay::hasPlot( StrView plotName ) {
     return getPlotIndex( plotName ) > -1;
   }
 
@@ -171,27 +571,347 @@ namespace DisplayTask {
   }
 
   void TextDisplay::clearLogs( void ) {
-    _logs = std::deque<std::string>();
-    for (int i=0; i<maxLogs; i++)
-      _logs.push_front( " " );
+    for (int i=0; i<maxLogs; i++) {
+      _logs[i][0] = ' ';
+      _logLen[i] = 1;
+    }
+    _oldest = 0;
+    _newLogs = 0;
+    _redraw = true;
   }
 
-  void TextDisplay::addLog( const std::string& newLog ) {
-    _logs.pop_front();
-    _logs.push_back( newLog );
+  void TextDisplay::addLog( StrView newLog ) {
+    _logLen[_oldest] = std::min( newLog.len, maxLogLen );
+    memcpy( _logs[_oldest], newLog.data, _logLen[_oldest] );
+    if ( ++_oldest == maxLogs ) _oldest = 0;
+    _newLogs++;
   }
 
+  // The log lines scroll in hardware: a new line is drawn into the slot
+  // of the oldest one, which the scroll then moves to the bottom.
   void TextDisplay::drawLogs( void ) {
-    int x = left, y = top;
-    for (int i=0; i<maxLogs; i++) {
-      y += logHeight;
-      Draw_8x12_string( (char *)_logs[i].c_str(), _logs[i].length(), x, y, 0xFF);
+    if ( _redraw ) {
+      clear();
+      set_scroll_area( top + logHeight, maxLogs * logHeight );
+      for (int i=0; i<maxLogs; i++)
+        drawLog( i, (_oldest + i) % maxLogs );
+      _redraw = false;
+      _newLogs = 0;
+      return;
+    }
+    int newLogs = std::min( _newLogs, maxLogs );
+    for (int i=maxLogs-newLogs; i<maxLogs; i++) {
+      scroll_area( logHeight );
+      drawLog( maxLogs - 1, (_oldest + i) % maxLogs );
+    }
+    _newLogs = 0;
+  }
+
+  void TextDisplay::drawLog( int slot, int log ) {
+    int y = scroll_row( slot * logHeight );
+    clear_vram( left, y, width(), logHeight );
+    Draw_8x12_string( _logs[log], _logLen[log], left, y, 0xFF);
+  }
+
+  // Samples that only went into a bin leave nothing new to draw.
+  static void addSample( int id, int value ) {
+    displayStats.samples++;
+    if ( graphDisplay.addData( id, value ) ) {
+      displayStats.points++;
+      // make sure we transition to the next state
+      hasNewPlotData = true;
+    }
+  }
+
+  // The name a plot is looked up by: name with prefix in front, put
+  // together in buf if there is a prefix.
+  static StrView plotName( StrView prefix, StrView name, char* buf ) {
+    if ( prefix.len == 0 )
+      return name;
+    int len = std::min( name.len, MAX_PLOT_NAME_LEN - prefix.len );
+    memcpy( buf, prefix.data, prefix.len );
+    memcpy( buf + prefix.len, name.data, len );
+    return StrView( buf, prefix.len + len );
+  }
+
+  // Parses one message and applies it to the windows, only marking what
+  // changed; the next frame draws it.  Plot names in it get prefix.
+  static void applyMessage( StrView data, bool cut = false, StrView prefix = StrView() ) {
+    static const StrView shiftPlotCommand = "SHIFT PLOT:"; // followed by log name
+    static const StrView shiftPlotsCommand = "SHIFT PLOTS";
+    static const StrView removePlotCommand = "REMOVE PLOT:"; // followed by log name
+    static const StrView clearPlotsCommand = "CLEAR PLOTS";
+    static const StrView clearLogsCommand = "CLEAR LOGS";
+    static const StrView spanPlotsCommand = "SPAN PLOTS:"; // followed by number of samples
+    static const StrView binPlotCommand = "BIN PLOT:"; // followed by plot name, ':' and samples per point, 0 for auto
+    static const StrView statsCommand = "STATS"; // counters and log, printed on the console
+
+    LineParser parser( data.data, data.len, parseStats, cut );
+    Line line;
+    char nameBuf[ MAX_PLOT_NAME_LEN ];
+    while ( parser.next( line ) ) {
+      if ( line.kind == Line::COMMAND ) {
+        StrView command = line.name;
+        int value;
+        if (command == clearLogsCommand) {
+          debugDisplay.clearLogs();
+          // make sure we transition to the next state
+          hasNewTextData = true;
+        }
+        else if (command == clearPlotsCommand) {
+          graphDisplay.clearPlots();
+          // make sure we transition to the next state
+          hasNewPlotData = true;
+        }
+        else if ( command.startsWith(spanPlotsCommand) &&
+                  LineParser::parseValue( command.from(spanPlotsCommand.len), value ) ) {
+          graphDisplay.setSpan( value );
+          // make sure we transition to the next state
+          hasNewPlotData = true;
+        }
+        else if ( command.startsWith(binPlotCommand) ) {
+          StrView args = command.from(binPlotCommand.len);
+          int colon = args.len - 1;
+          while ( colon >= 0 && args.data[colon] != ':' )
+            colon--;
+          if ( colon >= 0 && LineParser::parseValue( args.from(colon + 1), value ) )
+            graphDisplay.setBinWidth( graphDisplay.plotId( plotName( prefix, StrView( args.data, colon ), nameBuf ) ), value );
+          else
+            parseStats.unknownCommands++;
+        }
+        else if (command == statsCommand) {
+          Diagnostics::requestReport();
+        }
+        else if ( command.startsWith(removePlotCommand) ) {
+          graphDisplay.removePlot( plotName( prefix, command.from(removePlotCommand.len), nameBuf ) );
+          // make sure we transition to the next state
+          hasNewPlotData = true;
+        }
+        else {
+          parseStats.unknownCommands++;
+        }
+      }
+      else if ( line.kind == Line::DATA ) {
+        // a batch line is applied in one go, looking each plot up once
+        StrView name = line.name;
+        int id = graphDisplay.plotId( plotName( prefix, name, nameBuf ) );
+        do {
+          if ( line.name.data != name.data ) {
+            name = line.name;
+            id = graphDisplay.plotId( plotName( prefix, name, nameBuf ) );
+          }
+          addSample( id, line.value );
+        } while ( parser.nextSample( line ) );
+      }
+      else {
+        // couldn't find that, so we just have text data
+        debugDisplay.addLog( line.text );
+        // make sure we transition to the next state
+        hasNewTextData = true;
+      }
+    }
+  }
+
+  // Feeds the samples of one binary frame to the same plots the text
+  // lines go to.  Each series keeps its plot id until the plots change.
+  static void applyFrame( BinaryDecoder& decoder, StrView frame, StrView prefix ) {
+    char nameBuf[ MAX_PLOT_NAME_LEN ];
+    int series, value;
+    decoder.begin( frame );
+    while ( decoder.next( series, value ) ) {
+      BinaryDecoder::Series& s = decoder.series( series );
+      if ( s.plot == -1 || s.generation != graphDisplay.generation() ) {
+        s.plot = graphDisplay.plotId( plotName( prefix, StrView( s.name, s.nameLen ), nameBuf ) );
+        s.generation = graphDisplay.generation();
+      }
+      addSample( s.plot, wholeToSample( value ) );
+    }
+  }
+
+  // What a source's records are framed and decoded with.  UDP senders
+  // each have their own, by slot.
+  struct Stream {
+    StreamFramer*  framer;
+    BinaryDecoder* decoder;
+    StrView        prefix;
+    char           prefixBuf[8];
+  };
+
+  static void udpStream( int slot, Stream& stream ) {
+    stream.framer  = &udpFramers[slot];
+    stream.decoder = &udpDecoders[slot];
+    stream.prefix  = StrView();
+    if ( UDP_SOURCE_PREFIX )
+      stream.prefix = StrView( stream.prefixBuf, snprintf( stream.prefixBuf, sizeof(stream.prefixBuf), "%d/", slot + 1 ) );
+  }
+
+  // false for a tag naming no slot of the source table
+  static bool sourceStream( int source, uint32_t tag, Stream& stream ) {
+    if ( source != INGEST_UDP ) {
+      stream.framer  = &ingestFramers[source];
+      stream.decoder = &binaryDecoders[source];
+      stream.prefix  = StrView();
+      return true;
+    }
+    int slot = senderSlot( tag );
+    if ( slot >= UDP_MAX_SOURCES )
+      return false;
+    // a slot given to another sender starts over, without the plots of
+    // the sender it had before
+    udpStream( slot, stream );
+    if ( udpGenerations[slot] != senderGeneration( tag ) ) {
+      udpGenerations[slot] = senderGeneration( tag );
+      udpFramers[slot]  = StreamFramer();
+      udpDecoders[slot] = BinaryDecoder();
+      if ( UDP_SOURCE_PREFIX )
+        graphDisplay.removePlots( stream.prefix );
+    }
+    return true;
+  }
+
+  static void applyRecord( Stream& stream, StrView record ) {
+    if ( BinaryDecoder::isFrame( record ) )
+      applyFrame( *stream.decoder, record, stream.prefix );
+    else
+      applyMessage( record, stream.framer->cut(), stream.prefix );
+  }
+
+  // a line still waiting for its end once its source has gone quiet is
+  // taken as it is
+  static void flushIdle( Stream& stream, bool drained, uint32_t now ) {
+    StrView record;
+    if ( stream.framer->pending() && drained &&
+         now - stream.framer->lastStamp() >= FRAMER_IDLE_MS * 1000 &&
+         stream.framer->flush( record ) )
+      applyMessage( record, false, stream.prefix );
+  }
+
+  // ms until framer's unterminated line is due to be flushed
+  static uint32_t msUntilFlush( const StreamFramer& framer, uint32_t now ) {
+    if ( !framer.pending() )
+      return UINT32_MAX;
+    uint32_t since = now - framer.lastStamp();
+    uint32_t left = since >= FRAMER_IDLE_MS * 1000 ? 0 : FRAMER_IDLE_MS * 1000 - since;
+    return (left + 999) / 1000;
+  }
+
+  // Applies every waiting message, taking the sources in turn, until the
+  // rings are empty or the frame's time budget is spent; anything left
+  // over is picked up by the next frame.  Commands go before any other
+  // source and are applied whatever is left of the budget.
+  static void drainIngest( void ) {
+    static int nextSource = 0;
+    uint32_t start = now_us();
+    uint32_t backlog = 0;
+    for (int i=0; i<NUM_INGEST_SOURCES; i++)
+      backlog += sourceUsed( i );
+    displayStats.maxBacklog = std::max( displayStats.maxBacklog, backlog );
+    // before anything is applied, so samples are stamped with this drain
+    graphDisplay.updateRates( start );
+
+    uint32_t batch = 0;
+    while ( true ) {
+      int      source = -1;
+      StrView  newData;
+      uint32_t stamp;
+      uint32_t tag = 0;
+      if ( ingestRings[INGEST_COMMAND].peek( newData, &stamp ) ) {
+        source = INGEST_COMMAND;
+      } else {
+        if ( batch > 0 && now_us() - start >= INGEST_BUDGET_US ) {
+          displayStats.budgetHits++;
+          break;
+        }
+        for (int i=0; i<NUM_INGEST_SOURCES && source == -1; i++) {
+          int s = (nextSource + i) % NUM_INGEST_SOURCES;
+          if ( peekSource( s, newData, &stamp, &tag ) )
+            source = s;
+        }
+        if ( source == -1 )
+          break;
+        nextSource = (source + 1) % NUM_INGEST_SOURCES;
+      }
+      // have data, parse whole lines in place in the ring; a datagram of
+      // no known sender is dropped rather than joined to another's lines
+      Stream stream;
+      if ( !sourceStream( source, tag, stream ) ) {
+        displayStats.badTags++;
+        releaseSource( source );
+        continue;
+      }
+      StrView record;
+      stream.framer->feed( newData.data, newData.len, stamp );
+      while ( stream.framer->next( record ) )
+        applyRecord( stream, record );
+      releaseSource( source );
+
+      // ages are kept relative to when the frame started collecting
+      if ( frameMessages == 0 )
+        frameStart = start;
+      int32_t age = (int32_t) (frameStart - stamp);
+      frameAgeSum += age;
+      frameMaxAge = std::max( frameMaxAge, age );
+      frameMessages++;
+      batch++;
+    }
+    displayStats.messages += batch;
+    displayStats.maxBatch = std::max( displayStats.maxBatch, batch );
+
+    uint32_t now = now_us();
+    Stream stream;
+    for (int s=0; s<NUM_INGEST_RINGS; s++) {
+      sourceStream( s, 0, stream );
+      flushIdle( stream, sourceUsed( s ) == 0, now );
+    }
+    bool udpDrained = datagramPool.used() == 0;
+    for (int slot=0; slot<UDP_MAX_SOURCES; slot++) {
+      if ( !udpFramers[slot].pending() )
+        continue;
+      udpStream( slot, stream );
+      flushIdle( stream, udpDrained, now );
+    }
+  }
+
+  // ms until the oldest unterminated line is flushed, UINT32_MAX if none
+  static uint32_t msUntilFlushDue( void ) {
+    uint32_t wait = UINT32_MAX;
+    uint32_t now = now_us();
+    for (int s=0; s<NUM_INGEST_RINGS; s++)
+      wait = std::min( wait, msUntilFlush( ingestFramers[s], now ) );
+    for (int slot=0; slot<UDP_MAX_SOURCES; slot++)
+      wait = std::min( wait, msUntilFlush( udpFramers[slot], now ) );
+    return wait;
+  }
+
+  // Draws everything the drained messages changed and sends it out once.
+  static void renderFrame( void ) {
+    if ( hasNewTextData )
+      debugDisplay.drawLogs();
+    if ( hasNewPlotData )
+      graphDisplay.drawPlots();
+    hasNewTextData = false;
+    hasNewPlotData = false;
+    flush_vram();
+    lastFrame = now_us();
+
+    displayStats.frames++;
+    if ( frameMessages > 0 ) {
+      int32_t elapsed = (int32_t) (now_us() - frameStart);
+      displayStats.latencySumUs += frameAgeSum + (int64_t) frameMessages * elapsed;
+      displayStats.latencyMessages += frameMessages;
+      displayStats.latencyMeanUs = displayStats.latencySumUs / displayStats.latencyMessages;
+      displayStats.latencyMaxUs = std::max( displayStats.latencyMaxUs,
+                                            (uint32_t) (frameMaxAge + elapsed) );
+      frameMessages = 0;
+      frameAgeSum = 0;
+      frameMaxAge = 0;
     }
   }
 
   // Generated state variables
   bool     __change_state__ = false;
   uint32_t __state_delay__ = 0;
+  bool     __state_blocking__ = false; // wait for a notification, at most __state_delay__
   uint8_t  stateLevel_0;
 
   // Generated task function
@@ -199,9 +919,26 @@ namespace DisplayTask {
     // initialize here
     __change_state__ = false;
     __state_delay__ = 100;
+    __state_blocking__ = true;
     state_Wait_For_Data_setState();
     // execute the init transition for the initial state and task
-    qDataMutex = xSemaphoreCreateMutex();
+    displayTask = xTaskGetCurrentTaskHandle();
+    Diagnostics::addCounter( "parse.lines",           &parseStats.lines );
+    Diagnostics::addCounter( "parse.samples",         &parseStats.samples );
+    Diagnostics::addCounter( "parse.commands",        &parseStats.commands );
+    Diagnostics::addCounter( "parse.badValues",       &parseStats.badValues );
+    Diagnostics::addCounter( "parse.unknownCommands", &parseStats.unknownCommands );
+    Diagnostics::addCounter( "display.frames",        &displayStats.frames );
+    Diagnostics::addCounter( "display.budgetHits",    &displayStats.budgetHits );
+    Diagnostics::addCounter( "display.latencyMaxUs",  &displayStats.latencyMaxUs );
+    Diagnostics::addCounter( "display.latencyMeanUs", &displayStats.latencyMeanUs );
+    Diagnostics::addCounter( "display.latencyMessages", &displayStats.latencyMessages );
+    Diagnostics::addCounter( "display.points",        &displayStats.points );
+    Diagnostics::addCounter( "display.plotsEvicted",  &displayStats.plotsEvicted );
+    Diagnostics::addCounter( "display.plotsRejected", &displayStats.plotsRejected );
+    Diagnostics::addCounter( "ingest.serial.overflows", &ingestRings[INGEST_SERIAL].stats().overflows );
+    Diagnostics::addCounter( "ingest.udp.poolEmpty",    &datagramPool.stats().empty );
+    Diagnostics::addCounter( "ingest.udp.badTags",      &displayStats.badTags );
 
     debugDisplay.init();
 
@@ -219,7 +956,10 @@ namespace DisplayTask {
       state_Wait_For_Data_execute();
       // now wait if we haven't changed state
       if (!__change_state__) {
-        vTaskDelay( MS_TO_TICKS(__state_delay__) );
+        if (__state_blocking__)
+          ulTaskNotifyTake( pdTRUE, MS_TO_TICKS_CEIL(__state_delay__) );
+        else
+          vTaskDelay( MS_TO_TICKS(__state_delay__) );
       }
       else {
         vTaskDelay( MS_TO_TICKS(1) );
@@ -239,8 +979,7 @@ namespace DisplayTask {
     // execute all substates
 
     if (!__change_state__) {
-      debugDisplay.drawLogs();
-      display_vram();
+      renderFrame();
       updateDone = true;
     }
   }
@@ -259,7 +998,8 @@ namespace DisplayTask {
       // set the current state to the state we are transitioning to
       state_Wait_For_Data_setState();
       // start state timer (@ next states period)
-      __state_delay__ = 100;
+      __state_delay__ = WAIT_IDLE_MS;
+      __state_blocking__ = true;
       // execute the transition function
       updateDone = false;
 
@@ -281,8 +1021,7 @@ namespace DisplayTask {
     // execute all substates
 
     if (!__change_state__) {
-      graphDisplay.drawPlots();
-      display_vram();
+      renderFrame();
       updateDone = true;
     }
   }
@@ -301,7 +1040,8 @@ namespace DisplayTask {
       // set the current state to the state we are transitioning to
       state_Wait_For_Data_setState();
       // start state timer (@ next states period)
-      __state_delay__ = 100;
+      __state_delay__ = WAIT_IDLE_MS;
+      __state_blocking__ = true;
       // execute the transition function
       updateDone = false;
 
@@ -323,76 +1063,13 @@ namespace DisplayTask {
     // execute all substates
 
     if (!__change_state__) {
-      static const std::string dataDelim = "::";
-      static const std::string commandDelim = "+++"; // should start with this for command
-      static const std::string shiftPlotCommand = "SHIFT PLOT:"; // followed by log name
-      static const std::string shiftPlotsCommand = "SHIFT PLOTS";
-      static const std::string removePlotCommand = "REMOVE PLOT:"; // followed by log name
-      static const std::string clearPlotsCommand = "CLEAR PLOTS";
-      static const std::string clearLogsCommand = "CLEAR LOGS";
-
-      std::string newData = popData();
-      int len = newData.length();
-      if(len > 0) {
-        // have data, parse here
-        std::stringstream ss(newData);
-        std::string line;
-        while (std::getline(ss, line, '\n')) {
-          size_t pos = 0;
-          // parse for commands
-          if ( (pos = line.find(commandDelim)) != std::string::npos) {
-            std::string command;
-            std::string plotName;
-            command = line.substr(pos + commandDelim.length(), line.length());
-            if (command == clearLogsCommand) {
-              debugDisplay.clearLogs();
-              // make sure we transition to the next state
-              hasNewTextData = true;
-            }
-            else if (command == clearPlotsCommand) {
-              graphDisplay.clearPlots();
-              // make sure we transition to the next state
-              hasNewPlotData = true;
-            }
-            else if ( (pos = line.find(removePlotCommand)) != std::string::npos) {
-              plotName = line.substr(pos + removePlotCommand.length(), line.length());
-              graphDisplay.removePlot( plotName );
-              // make sure we transition to the next state
-              hasNewPlotData = true;
-            }
-          }
-          else {
-            // parse for data
-            if ( (pos = line.find(dataDelim)) != std::string::npos) {
-              // found "::" so we have a plot data
-              std::string plotName;
-              std::string value;
-              int         iValue;
-              plotName = line.substr(0, pos);
-              pos = pos + dataDelim.length();
-              if ( pos < line.length() ) {
-                value = line.substr(pos, line.length());
-                iValue = std::stoi(value);
-                // make sure we transition to the next state
-                graphDisplay.addData( plotName, iValue );
-                hasNewPlotData = true;
-              }
-              else {
-                // couldn't find that, so we just have text data
-                debugDisplay.addLog( line );
-                // make sure we transition to the next state
-                hasNewTextData = true;
-              }
-            }
-            else {
-              // couldn't find that, so we just have text data
-              debugDisplay.addLog( line );
-              // make sure we transition to the next state
-              hasNewTextData = true;
-            }
-          }
-        }
-      }
+      drainIngest();
+      // sleep until the next frame may be drawn, a partial line is due to
+      // be flushed, or more data comes
+      if ( hasNewTextData || hasNewPlotData )
+        __state_delay__ = msUntilFrameDue();
+      else
+        __state_delay__ = std::min( msUntilFlushDue(), (uint32_t) WAIT_IDLE_MS );
     }
   }
 
@@ -403,30 +1080,28 @@ namespace DisplayTask {
   void state_Wait_For_Data_transition( void ) {
     if (__change_state__)
       return;
-    else if ( hasNewTextData ) {
+    else if ( hasNewTextData && frameDue() ) {
       __change_state__ = true;
       // run the current state's finalization function
       state_Wait_For_Data_finalization();
       // set the current state to the state we are transitioning to
       state_Update_Text_setState();
       // start state timer (@ next states period)
-      __state_delay__ = 100;
-      // execute the transition function
-      hasNewTextData = false;
-          debugDisplay.clear();
+      __state_delay__ = 0;
+      __state_blocking__ = false;
+      // execute the transition function, the frame clears the flags
 
     }
-    else if ( hasNewPlotData ) {
+    else if ( hasNewPlotData && frameDue() ) {
       __change_state__ = true;
       // run the current state's finalization function
       state_Wait_For_Data_finalization();
       // set the current state to the state we are transitioning to
       state_Update_Graph_setState();
       // start state timer (@ next states period)
-      __state_delay__ = 100;
-      // execute the transition function
-      hasNewPlotData = false;
-          graphDisplay.clear();
+      __state_delay__ = 0;
+      __state_blocking__ = false;
+      // execute the transition function, the frame clears the flags
 
     }
   }
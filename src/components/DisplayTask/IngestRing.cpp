@@ -0,0 +1,122 @@
+#include "IngestRing.hpp"
+#include <string.h>
+#include <algorithm>
+
+namespace DisplayTask {
+
+  static_assert( (INGEST_RING_SIZE & (INGEST_RING_SIZE - 1)) == 0,
+                 "INGEST_RING_SIZE must be a power of two" );
+
+  bool IngestRing::push( const char* data, int len, uint32_t stamp ) {
+    bool ok = true;
+    while ( len > 0 ) {
+      int n = len < maxMessage ? len : maxMessage;
+      ok = pushMessage( data, n, stamp ) && ok;
+      data += n;
+      len -= n;
+    }
+    return ok;
+  }
+
+  bool IngestRing::pushMessage( const char* data, int len, uint32_t stamp ) {
+    uint32_t head = _head.load( std::memory_order_relaxed );
+    uint32_t tail = _tail.load( std::memory_order_acquire );
+    uint32_t need = footprint( len );
+    uint32_t pos  = head & (size - 1);
+    uint32_t skip = size - pos < need ? size - pos : 0;
+    if ( size - (head - tail) < skip + need ) {
+      _stats.overflows++;
+      _stats.droppedBytes += len;
+      return false;
+    }
+    if ( skip > 0 ) {
+      memcpy( _buf + pos, &wrapMarker, 2 );
+      head += skip;
+      pos = 0;
+    }
+    uint16_t length = len;
+    memcpy( _buf + pos, &length, 2 );
+    memcpy( _buf + pos + 2, &stamp, 4 );
+    memcpy( _buf + pos + header, data, len );
+    head += need;
+    _head.store( head, std::memory_order_release );
+
+    _stats.messages++;
+    _stats.bytes += len;
+    if ( head - tail > _stats.highWater )
+      _stats.highWater = head - tail;
+    return true;
+  }
+
+  // Takes whichever is larger of the room before the end of the buffer
+  // and the room at the front, unless the first already holds len.  The
+  // wrap marker can be written early as the consumer stops at _head.
+  char* IngestRing::reserve( int& len ) {
+    uint32_t head = _head.load( std::memory_order_relaxed );
+    uint32_t tail = _tail.load( std::memory_order_acquire );
+    int      free = size - (head - tail);
+    uint32_t pos  = head & (size - 1);
+    int      end  = std::min( (int) (size - pos), free ) - header;
+    int      front = free - (int) (size - pos) - header;
+    len = std::min( len, (int) maxMessage );
+    _skip = 0;
+    if ( end < len && front > end ) {
+      memcpy( _buf + pos, &wrapMarker, 2 );
+      _skip = size - pos;
+      pos = 0;
+      end = front;
+    }
+    if ( end <= 0 )
+      return nullptr;
+    len = std::min( len, end );
+    return _buf + pos + header;
+  }
+
+  void IngestRing::commit( int len, uint32_t stamp ) {
+    if ( len <= 0 )
+      return;
+    uint32_t head = _head.load( std::memory_order_relaxed ) + _skip;
+    uint32_t tail = _tail.load( std::memory_order_acquire );
+    char*    msg  = _buf + (head & (size - 1));
+    uint16_t length = len;
+    memcpy( msg, &length, 2 );
+    memcpy( msg + 2, &stamp, 4 );
+    head += footprint( len );
+    _head.store( head, std::memory_order_release );
+
+    _stats.messages++;
+    _stats.bytes += len;
+    if ( head - tail > _stats.highWater )
+      _stats.highWater = head - tail;
+  }
+
+  bool IngestRing::peek( StrView& message, uint32_t* stamp ) {
+    uint32_t tail = _tail.load( std::memory_order_relaxed );
+    uint32_t head = _head.load( std::memory_order_acquire );
+    if ( tail == head )
+      return false;
+    uint32_t pos = tail & (size - 1);
+    uint16_t length;
+    memcpy( &length, _buf + pos, 2 );
+    if ( length == wrapMarker ) {
+      // the message after a marker is always at the front
+      tail += size - pos;
+      pos = 0;
+      memcpy( &length, _buf, 2 );
+    }
+    if ( stamp != nullptr )
+      memcpy( stamp, _buf + pos + 2, 4 );
+    message = StrView( _buf + pos + header, length );
+    _peekEnd = tail + footprint( length );
+    return true;
+  }
+
+  void IngestRing::release( void ) {
+    _tail.store( _peekEnd, std::memory_order_release );
+  }
+
+  int IngestRing::used( void ) const {
+    return _head.load( std::memory_order_acquire ) - _tail.load( std::memory_order_acquire );
+  }
+
+};
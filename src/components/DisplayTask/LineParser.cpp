@@ -0,0 +1,184 @@
+#include "LineParser.hpp"
+#include <algorithm>
+
+namespace DisplayTask {
+
+  bool LineParser::next( Line& line ) {
+    if ( _pos >= _end )
+      return false;
+    const char* start        = _pos;
+    const char* dataDelim    = nullptr;  // first "::"
+    const char* commandDelim = nullptr;  // first "+++"
+    const char* p = start;
+    for ( ; p < _end && *p != '\n'; p++ ) {
+      if ( *p == ':' ) {
+        if ( dataDelim == nullptr && p + 1 < _end && p[1] == ':' )
+          dataDelim = p;
+      }
+      else if ( *p == '+' ) {
+        if ( commandDelim == nullptr && p + 2 < _end && p[1] == '+' && p[2] == '+' )
+          commandDelim = p;
+      }
+    }
+    _pos = p < _end ? p + 1 : p;
+    // serial terminals end lines with "\r\n"
+    const char* stop = p;
+    if ( stop > start && stop[-1] == '\r' )
+      stop--;
+
+    _stats.lines++;
+    line.text = StrView( start, stop - start );
+    line.value = 0;
+    line.rest = StrView();
+    if ( commandDelim != nullptr ) {
+      line.kind = Line::COMMAND;
+      line.name = StrView( commandDelim + 3, std::max( 0, (int)(stop - commandDelim - 3) ) );
+      _stats.commands++;
+      return true;
+    }
+    if ( dataDelim != nullptr && dataDelim + 2 < stop ) {
+      const char* value = dataDelim + 2;
+      if ( scanValue( value, stop, line.value ) &&
+           (value == stop ? !(_cut && stop == _end) : *value == ',' || *value == ';') ) {
+        line.kind = Line::DATA;
+        line.name = StrView( start, dataDelim - start );
+        line.rest = StrView( value, stop - value );
+        _stats.dataLines++;
+        _stats.samples++;
+        return true;
+      }
+      // shown as text so the sender can see what went wrong
+      _stats.badValues++;
+    }
+    line.kind = Line::TEXT;
+    line.name = StrView();
+    _stats.textLines++;
+    return true;
+  }
+
+  bool LineParser::nextSample( Line& line ) {
+    const char* p   = line.rest.data;
+    const char* end = line.rest.data + line.rest.len;
+    if ( p >= end )
+      return false;
+    line.rest = StrView();
+    char separator = *p++;
+    while ( p < end && (*p == ' ' || *p == '\t') )
+      p++;
+    // a trailing separator ends the batch
+    if ( p == end )
+      return false;
+    if ( separator == ';' ) {
+      // another plot
+      const char* name = p;
+      while ( p + 1 < end && !(p[0] == ':' && p[1] == ':') )
+        p++;
+      if ( p + 1 >= end ) {
+        _stats.badValues++;
+        return false;
+      }
+      line.name = StrView( name, p - name );
+      p += 2;
+    }
+    if ( !scanValue( p, end, line.value ) ||
+         (p < end ? *p != ',' && *p != ';' : _cut && end == _end) ) {
+      _stats.badValues++;
+      return false;
+    }
+    line.rest = StrView( p, end - p );
+    _stats.samples++;
+    return true;
+  }
+
+  bool LineParser::parseValue( StrView text, int& value ) {
+    const char* p = text.data;
+    int sample;
+    if ( !scanValue( p, text.data + text.len, sample ) || p != text.data + text.len )
+      return false;
+    value = sample / (1 << SAMPLE_FRAC_BITS);
+    return true;
+  }
+
+  static inline bool isDigit( char c ) { return c >= '0' && c <= '9'; }
+
+  // Digits are gathered into a 64 bit mantissa and a power of ten, which
+  // are turned into a sample once at the end, rounded to the nearest
+  // step.  No floating point and no locale are involved.
+  bool LineParser::scanValue( const char*& p, const char* end, int& value ) {
+    static const uint64_t powersOf10[] = {
+      1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+      100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+      1000000000000ull, 10000000000000ull, 100000000000000ull,
+      1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+      1000000000000000000ull, 10000000000000000000ull
+    };
+    // more digits than this cannot change a 32 bit sample, and the
+    // mantissa stays below 2^54 so it can be shifted into fixed point
+    const int maxSignificant = 16;
+
+    while ( p < end && (*p == ' ' || *p == '\t') )
+      p++;
+    bool negative = false;
+    if ( p < end && (*p == '-' || *p == '+') )
+      negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int      exponent = 0;
+    int      digits = 0;
+    int      significant = 0;
+    for ( ; p < end && isDigit( *p ); p++, digits++ ) {
+      if ( significant < maxSignificant ) {
+        mantissa = mantissa * 10 + (*p - '0');
+        significant += mantissa != 0;
+      }
+      else
+        exponent++;
+    }
+    if ( p < end && *p == '.' ) {
+      for ( p++; p < end && isDigit( *p ); p++, digits++ ) {
+        if ( significant < maxSignificant ) {
+          mantissa = mantissa * 10 + (*p - '0');
+          significant += mantissa != 0;
+          exponent--;
+        }
+      }
+    }
+    if ( digits == 0 )
+      return false;
+    if ( p < end && (*p == 'e' || *p == 'E') ) {
+      const char* e = p + 1;
+      bool negativeExponent = false;
+      if ( e < end && (*e == '-' || *e == '+') )
+        negativeExponent = *e++ == '-';
+      if ( e == end || !isDigit( *e ) )
+        return false;
+      int x = 0;
+      for ( ; e < end && isDigit( *e ); e++ )
+        if ( x < 1000 )
+          x = x * 10 + (*e - '0');
+      exponent += negativeExponent ? -x : x;
+      p = e;
+    }
+    while ( p < end && (*p == ' ' || *p == '\t') )
+      p++;
+
+    // too large a magnitude saturates, as wholeToSample() does
+    const uint64_t limit = negative ? (uint64_t) INT32_MAX + 1 : (uint64_t) INT32_MAX;
+    uint64_t fixed = mantissa << SAMPLE_FRAC_BITS;
+    if ( mantissa == 0 )
+      fixed = 0;
+    else if ( exponent >= 0 ) {
+      for ( ; exponent > 0 && fixed <= limit; exponent-- )
+        fixed *= 10;
+    }
+    else if ( -exponent < 20 ) {
+      uint64_t divisor = powersOf10[ -exponent ];
+      fixed = (fixed + divisor / 2) / divisor;
+    }
+    else
+      fixed = 0;
+    fixed = std::min( fixed, limit );
+    value = negative ? (int) (0u - (uint32_t) fixed) : (int) fixed;
+    return true;
+  }
+
+};
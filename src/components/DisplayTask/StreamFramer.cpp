@@ -0,0 +1,131 @@
+#include "StreamFramer.hpp"
+#include <string.h>
+#include <algorithm>
+
+namespace DisplayTask {
+
+  static_assert( FRAMER_MAX_LINE >= BinaryProtocol::maxFrame,
+                 "FRAMER_MAX_LINE must hold the largest binary frame" );
+
+  void StreamFramer::feed( const char* data, int len, uint32_t stamp ) {
+    _pos = data;
+    _end = data + len;
+    _stamp = stamp;
+  }
+
+  bool StreamFramer::next( StrView& record ) {
+    if ( _carryOut ) {
+      _carryLen = 0;
+      _carryOut = false;
+    }
+    _cut = false;
+    while ( _pos < _end ) {
+      if ( !_skipping && (inFrame() || (_carryLen == 0 && (uint8_t) *_pos == BINARY_MAGIC)) ) {
+        if ( nextFrame( record ) )
+          return true;
+        continue;
+      }
+      const char* nl   = (const char*) memchr( _pos, '\n', _end - _pos );
+      const char* stop = nl != nullptr ? nl + 1 : _end;
+      if ( _skipping ) {
+        _skipping = nl == nullptr;
+        _pos = stop;
+        continue;
+      }
+      if ( _carryLen == 0 && nl != nullptr ) {
+        // the whole record is in this chunk
+        int len = stop - _pos;
+        record = StrView( _pos, len < maxLine ? len : maxLine );
+        if ( len > maxLine ) {
+          _stats.overlong++;
+          _skipping = _policy == TRUNCATE;
+          _cut = true;
+        }
+        _pos += record.len;
+        _stats.records++;
+        return true;
+      }
+      // the record started in an earlier chunk or goes on in a later one
+      bool joined = _carryLen > 0;
+      if ( carry( _pos, stop - _pos ) ) {
+        if ( nl == nullptr )
+          return false;
+        if ( joined )
+          _stats.joined++;
+        return takeCarry( record );
+      }
+      // out of room before the end of the line
+      _stats.overlong++;
+      _skipping = _policy == TRUNCATE;
+      _cut = true;
+      return takeCarry( record );
+    }
+    return false;
+  }
+
+  bool StreamFramer::flush( StrView& record ) {
+    if ( _carryOut ) {
+      _carryLen = 0;
+      _carryOut = false;
+    }
+    _cut = false;
+    // whatever comes next starts a new record
+    _skipping = false;
+    if ( _carryLen == 0 )
+      return false;
+    if ( inFrame() ) {
+      // half a frame is no use to anyone
+      _stats.cutFrames++;
+      _carryLen = 0;
+      return false;
+    }
+    _stats.flushed++;
+    return takeCarry( record );
+  }
+
+  // A frame is taken in place if all of it is in the chunk, otherwise its
+  // header and then the rest of it are collected in the carry buffer.
+  bool StreamFramer::nextFrame( StrView& record ) {
+    using BinaryProtocol::header;
+    int avail = _end - _pos;
+    if ( _carryLen == 0 && avail >= header && avail >= header + (uint8_t) _pos[2] ) {
+      record = StrView( _pos, header + (uint8_t) _pos[2] );
+      _pos += record.len;
+      _stats.records++;
+      _stats.frames++;
+      return true;
+    }
+    bool joined = _carryLen > 0;
+    while ( true ) {
+      int want = _carryLen < header ? header : header + (uint8_t) _carry[2];
+      if ( _carryLen == want ) {
+        if ( joined )
+          _stats.joined++;
+        _stats.frames++;
+        return takeCarry( record );
+      }
+      if ( _pos == _end )
+        return false;
+      carry( _pos, std::min( want - _carryLen, (int) (_end - _pos) ) );
+    }
+  }
+
+  // copies as much as fits, false if not all of it did
+  bool StreamFramer::carry( const char* data, int len ) {
+    int n = maxLine - _carryLen;
+    if ( len < n )
+      n = len;
+    memcpy( _carry + _carryLen, data, n );
+    _carryLen += n;
+    _pos += n;
+    return n == len;
+  }
+
+  bool StreamFramer::takeCarry( StrView& record ) {
+    record = StrView( _carry, _carryLen );
+    _carryOut = true;
+    _stats.records++;
+    return true;
+  }
+
+};
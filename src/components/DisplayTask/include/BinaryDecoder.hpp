@@ -0,0 +1,57 @@
+#ifndef __BinaryDecoder__INCLUDE_GUARD
+#define __BinaryDecoder__INCLUDE_GUARD
+
+#include <cstdint>
+#include "BinaryProtocol.hpp"
+#include "LineParser.hpp"
+
+namespace DisplayTask {
+
+  struct BinaryStats {
+    uint32_t frames;
+    uint32_t samples;
+    uint32_t registrations;
+    uint32_t badFrames;       // unknown type or cut short
+    uint32_t unknownSeries;   // samples for a series never registered
+  };
+
+  // Receiving side of BinaryProtocol for one source.  Registrations are
+  // taken as the frame is begun; samples are then handed out one at a
+  // time, like lines from a LineParser.
+  class BinaryDecoder {
+    public:
+    struct Series {
+      char     name[ BINARY_MAX_NAME ];
+      int      nameLen;
+      bool     registered;
+      int32_t  last;        // previous sample, the base of the next delta
+      int      plot;        // for the caller: cached plot id, -1 for none
+      uint32_t generation;  // for the caller: when plot was looked up
+    };
+
+    BinaryDecoder( void ) : _pos(nullptr), _end(nullptr), _id(0), _count(0), _series(), _stats() {}
+
+    static bool isFrame ( StrView record ) {
+      return record.len > 0 && (uint8_t) record.data[0] == BINARY_MAGIC;
+    }
+
+    void begin ( StrView frame );              // a whole frame, from the StreamFramer
+    bool next  ( int& series, int& value );    // false once the frame is used up
+
+    Series&            series ( int id ) { return _series[id]; }
+    const BinaryStats& stats  ( void ) const { return _stats; }
+
+    private:
+    bool bad ( void );  // gives up on the rest of the frame
+
+    const uint8_t* _pos;
+    const uint8_t* _end;
+    int            _id;     // series of the current group
+    int            _count;  // samples left in the current group
+    Series         _series[ BINARY_MAX_SERIES ];
+    BinaryStats    _stats;
+  };
+
+};
+
+#endif // __BinaryDecoder__INCLUDE_GUARD
@@ -0,0 +1,153 @@
+#ifndef __BinaryProtocol__INCLUDE_GUARD
+#define __BinaryProtocol__INCLUDE_GUARD
+
+#include <cstdint>
+#include <string.h>
+
+// Compact alternative to "name::value" lines, mixed freely with text on
+// any source.  Every frame is
+//
+//   BINARY_MAGIC, type, payload length (0 - 255), payload
+//
+// BINARY_MAGIC never starts a line of ASCII or UTF-8 text, which is how
+// the receiver tells the two apart.  Payloads:
+//
+//   BINARY_REGISTER  series id (varint), name (the rest of the payload)
+//   BINARY_SAMPLES   groups of series id (varint), sample count (byte)
+//                    and that many zigzag varint deltas
+//
+// Samples are whole numbers.  Each delta is from the series' previous
+// sample, the first one after a registration from 0.  A series has to be
+// registered on the same source before its samples are sent, and again
+// if the receiver restarts.
+//
+// This header has no other dependencies so it can be built into the
+// sending side as well.
+
+#define BINARY_MAGIC      0xA5
+#define BINARY_REGISTER   0x01
+#define BINARY_SAMPLES    0x02
+
+// series ids per source are 0 .. BINARY_MAX_SERIES - 1
+#ifndef BINARY_MAX_SERIES
+#define BINARY_MAX_SERIES 16
+#endif
+// longest series name
+#ifndef BINARY_MAX_NAME
+#define BINARY_MAX_NAME   32
+#endif
+
+namespace BinaryProtocol {
+
+  static const int header     = 3;
+  static const int maxPayload = 255;
+  static const int maxFrame   = header + maxPayload;
+  static const int maxVarint  = 5;
+
+  inline uint32_t zigzag   ( int32_t v )  { return ((uint32_t) v << 1) ^ (uint32_t) (v >> 31); }
+  inline int32_t  unzigzag ( uint32_t v ) { return (int32_t) (v >> 1) ^ -(int32_t) (v & 1); }
+
+  // returns the bytes written, at most maxVarint
+  inline int putVarint( uint8_t* out, uint32_t v ) {
+    int n = 0;
+    while ( v >= 0x80 ) {
+      out[n++] = (uint8_t) (v | 0x80);
+      v >>= 7;
+    }
+    out[n++] = (uint8_t) v;
+    return n;
+  }
+
+  // returns the bytes read, 0 if the varint runs past end or is too long
+  inline int getVarint( const uint8_t* p, const uint8_t* end, uint32_t& v ) {
+    v = 0;
+    for (int n=0; n<maxVarint && p + n < end; n++) {
+      v |= (uint32_t) (p[n] & 0x7F) << (7 * n);
+      if ( (p[n] & 0x80) == 0 )
+        return n + 1;
+    }
+    return 0;
+  }
+
+  // Receives each finished frame.
+  typedef void (*Sink)( void* context, const uint8_t* frame, int len );
+
+  // Sender side: samples are packed into one BINARY_SAMPLES frame, runs
+  // of the same series sharing a group, and the frame goes to the sink
+  // when the next sample would not fit or on flush().
+  class Encoder {
+    public:
+    Encoder( Sink sink, void* context = nullptr )
+      : _sink(sink), _context(context), _len(0), _group(-1), _groupId(-1) {
+      memset( _last, 0, sizeof(_last) );
+    }
+
+    // sends any waiting samples first, false if id or name do not fit
+    bool registerSeries( int id, const char* name ) {
+      int nameLen = strlen( name );
+      if ( id < 0 || id >= BINARY_MAX_SERIES || nameLen > BINARY_MAX_NAME )
+        return false;
+      flush();
+      uint8_t frame[ maxFrame ];
+      int len = header;
+      len += putVarint( frame + len, id );
+      memcpy( frame + len, name, nameLen );
+      len += nameLen;
+      frame[0] = BINARY_MAGIC;
+      frame[1] = BINARY_REGISTER;
+      frame[2] = (uint8_t) (len - header);
+      _sink( _context, frame, len );
+      _last[id] = 0;
+      return true;
+    }
+
+    bool add( int id, int32_t value ) {
+      if ( id < 0 || id >= BINARY_MAX_SERIES )
+        return false;
+      uint8_t delta[ maxVarint ];
+      int deltaLen = putVarint( delta, zigzag( (int32_t) ((uint32_t) value - (uint32_t) _last[id]) ) );
+      bool newGroup = id != _groupId || _frame[ _group ] == 255;
+      int need = deltaLen + (newGroup ? maxVarint + 1 : 0);
+      if ( _len + need > maxFrame ) {
+        flush();
+        newGroup = true;
+      }
+      if ( _len == 0 )
+        _len = header;
+      if ( newGroup ) {
+        _len += putVarint( _frame + _len, id );
+        _group = _len++;
+        _frame[ _group ] = 0;
+        _groupId = id;
+      }
+      memcpy( _frame + _len, delta, deltaLen );
+      _len += deltaLen;
+      _frame[ _group ]++;
+      _last[id] = value;
+      return true;
+    }
+
+    void flush( void ) {
+      if ( _len == 0 )
+        return;
+      _frame[0] = BINARY_MAGIC;
+      _frame[1] = BINARY_SAMPLES;
+      _frame[2] = (uint8_t) (_len - header);
+      _sink( _context, _frame, _len );
+      _len = 0;
+      _groupId = -1;
+    }
+
+    private:
+    Sink    _sink;
+    void*   _context;
+    uint8_t _frame[ maxFrame ];
+    int     _len;      // 0 while no frame is started
+    int     _group;    // offset of the current group's count
+    int     _groupId;  // series of the current group, -1 for none
+    int32_t _last[ BINARY_MAX_SERIES ];
+  };
+
+};
+
+#endif // __BinaryProtocol__INCLUDE_GUARD
@@ -0,0 +1,81 @@
+#ifndef __DatagramPool__INCLUDE_GUARD
+#define __DatagramPool__INCLUDE_GUARD
+
+#include <cstdint>
+#include <atomic>
+#include "LineParser.hpp"
+
+// largest datagram payload that is not fragmented on a 1500 byte MTU
+#ifndef UDP_MAX_DATAGRAM
+#define UDP_MAX_DATAGRAM 1472
+#endif
+// buffers in the pool, a power of two
+#ifndef UDP_POOL_BUFFERS
+#define UDP_POOL_BUFFERS 8
+#endif
+// senders tracked at once, each with its own framing and plot names
+#ifndef UDP_MAX_SOURCES
+#define UDP_MAX_SOURCES  16
+#endif
+
+namespace DisplayTask {
+
+  // Datagrams are tagged with the slot of their sender in the receiver's
+  // source table and the slot's generation, which changes whenever the
+  // slot is given to another sender.
+  inline uint32_t senderTag        ( int slot, uint32_t generation ) { return generation << 8 | slot; }
+  inline int      senderSlot       ( uint32_t tag ) { return tag & 0xFF; }
+  inline uint32_t senderGeneration ( uint32_t tag ) { return tag >> 8; }
+
+  // Written by the producer only; the consumer may read them at any time.
+  struct PoolStats {
+    uint32_t datagrams;
+    uint32_t bytes;
+    uint32_t empty;       // acquire() found every buffer in use
+    uint32_t highWater;   // most buffers ever waiting
+  };
+
+  // Fixed pool of datagram sized buffers, handed from a single producer
+  // to a single consumer without copying: the receiver reads straight
+  // into the buffer acquire() gives it, and the consumer parses it in
+  // place until release().  Buffers go round in order, so the pool is a
+  // ring of whole buffers and takes the same lock-free scheme as
+  // IngestRing.
+  class DatagramPool {
+    public:
+    static const int count      = UDP_POOL_BUFFERS;
+    // one byte more than the largest datagram, a receive that fills it
+    // was truncated
+    static const int bufferSize = UDP_MAX_DATAGRAM + 1;
+
+    DatagramPool( void ) : _head(0), _tail(0), _stats() {}
+
+    // producer: a free buffer of bufferSize bytes, nullptr if there is
+    // none; submit() it once it is filled
+    char* acquire ( void );
+    void  submit  ( int len, uint32_t stamp = 0, uint32_t tag = 0 );
+
+    // consumer: the oldest datagram, kept until release()
+    bool peek    ( StrView& datagram, uint32_t* stamp = nullptr, uint32_t* tag = nullptr );
+    void release ( void );
+
+    int              used  ( void ) const;  // bytes waiting
+    const PoolStats& stats ( void ) const { return _stats; }
+
+    private:
+    struct Buffer {
+      int      len;
+      uint32_t stamp;
+      uint32_t tag;
+      char     data[ bufferSize ];
+    };
+
+    Buffer                _buffers[ count ];
+    std::atomic<uint32_t> _head;   // buffers ever submitted, wraps
+    std::atomic<uint32_t> _tail;   // buffers ever released, wraps
+    PoolStats             _stats;
+  };
+
+};
+
+#endif // __DatagramPool__INCLUDE_GUARD
@@ -2,16 +2,21 @@
 #define __DisplayTask__INCLUDE_GUARD
 
 #include <cstdint>
+#include "sdkconfig.h"
 
 // Task Includes
-#define _GLIBCXX_USE_C99 1    // needed for std::stoi
+#define _GLIBCXX_USE_C99 1    // needed for std::to_string
 
 #include "Display.hpp"
+#include "LineParser.hpp"
+#include "IngestRing.hpp"
+#include "DatagramPool.hpp"
+#include "StreamFramer.hpp"
+#include "BinaryDecoder.hpp"
+#include "Diagnostics.hpp"
 #include <string.h>
 #include <string>
-#include <sstream>
-#include <queue>
-#include <deque>
+#include <algorithm>
 #include <mutex>
 
 extern "C" {  
@@ -28,12 +33,88 @@ namespace DisplayTask {
   extern bool       updateDone;
   extern bool       hasNewPlotData;
   extern bool       hasNewTextData;
-  // for interacting sending data to the display
-  extern std::queue<std::string> qData;
-  extern SemaphoreHandle_t       qDataMutex;
+  // for interacting sending data to the display: every producing task
+  // gets its own ring, so pushing never blocks and never allocates
+  enum IngestSource {
+    INGEST_SERIAL,
+    INGEST_SYSTEM,  // wifi event handler
+    INGEST_COMMAND, // "+++" lines the serial task lifted out of its stream
+    NUM_INGEST_RINGS,
+    // datagrams, through datagramPool rather than a ring
+    INGEST_UDP = NUM_INGEST_RINGS,
+    NUM_INGEST_SOURCES
+  };
+  extern IngestRing ingestRings[ NUM_INGEST_RINGS ];
+  // cut what each source pushed back into lines, only used by the display task
+  extern StreamFramer ingestFramers[ NUM_INGEST_RINGS ];
+  // series registered by binary senders, per source
+  extern BinaryDecoder binaryDecoders[ NUM_INGEST_RINGS ];
+  // the same for each UDP sender, by its slot in the receiver's source
+  // table (see senderTag())
+  extern StreamFramer  udpFramers[ UDP_MAX_SOURCES ];
+  extern BinaryDecoder udpDecoders[ UDP_MAX_SOURCES ];
+
+  // only ever called from the task owning one of the rings (not for
+  // INGEST_UDP), false if data was dropped
+  bool pushData ( IngestSource source, const char* data, int len );
+  // the same, for reading straight into the ring: room for up to len
+  // bytes, nullptr while the ring is full, then commit what was read
+  char* reserveData ( IngestSource source, int& len );
+  void  commitData  ( IngestSource source, int len );
+  // datagrams are received straight into a pool buffer: one of
+  // DatagramPool::bufferSize bytes, nullptr while all are in use (the
+  // caller is then notified when one is released), then submit what was
+  // received with its sender's tag
+  extern DatagramPool datagramPool;
+  char* acquireDatagram ( void );
+  void  submitDatagram  ( int len, uint32_t tag = 0 );
+
+  // plot names from UDP senders get their slot in front, "3/temp", so
+  // two senders of "temp" do not share a plot; 0 to share them.  A slot
+  // given to a new sender drops the plots of the one before.
+#ifndef UDP_SOURCE_PREFIX
+  #define UDP_SOURCE_PREFIX 1
+#endif
+
+  // counts over everything parsed since boot
+  extern ParseStats parseStats;
+
+  // time each frame may spend applying waiting messages before it draws
+#ifndef INGEST_BUDGET_US
+  #define INGEST_BUDGET_US 4000
+#endif
 
-  void        pushData ( std::string data );
-  std::string popData  ( void );
+  // frames are drawn at most this often, bursts in between are coalesced
+#ifndef MAX_FRAME_RATE
+  #define MAX_FRAME_RATE 30
+#endif
+  // longest the display task sleeps when nobody notifies it
+#ifndef WAIT_IDLE_MS
+  #define WAIT_IDLE_MS 1000
+#endif
+
+  struct DisplayStats {
+    uint32_t frames;
+    uint32_t messages;       // applied to the windows
+    uint32_t maxBatch;       // most messages applied in one frame
+    uint32_t maxBacklog;     // most bytes waiting when a frame started
+    uint32_t budgetHits;     // frames that left messages for the next one
+    uint32_t latencyMaxUs;   // push to flush
+    uint64_t latencySumUs;   // push to flush, over latencyMessages (too wide for a counter)
+    uint32_t latencyMessages; // flushed so far
+    uint32_t latencyMeanUs;  // latencySumUs / latencyMessages, as of the last frame
+    uint32_t samples;        // given to the plots
+    uint32_t points;         // plot points the samples were binned into
+    uint32_t plotsEvicted;   // idle plots replaced once MAX_PLOTS were in use
+    uint32_t plotsRejected;  // new plots turned away, no plot being idle
+    uint32_t badTags;        // datagrams dropped, their sender slot outside the table
+  };
+  extern DisplayStats displayStats;
+
+  // smallest power of two that is at least n
+  constexpr int pow2AtLeast( int n, int p = 1 ) {
+    return p >= n ? p : pow2AtLeast( n, p * 2 );
+  }
 
   class Window {
     public:
@@ -54,44 +135,150 @@ namespace DisplayTask {
 
   class GraphDisplay : public Window {
     public:
-    GraphDisplay( int l, int r, int t, int b ) : Window(l, r, t, b) {}
+    GraphDisplay( int l, int r, int t, int b ) : Window(l, r, t, b) { rebuildIndex(); }
     
     #define MAX_PLOT_NAME_LEN 100
     #define MIN_X_SPACING     12
-    #define MAX_PLOT_DATA_LEN (DISPLAY_WIDTH / MIN_X_SPACING)
+    #define DEFAULT_PLOT_SPAN (DISPLAY_WIDTH / MIN_X_SPACING) // samples shown
+#ifndef MAX_PLOTS
     #define MAX_PLOTS         10
+#endif
+
+    // Samples kept per plot, a power of two.  With PSRAM the history is
+    // allocated there, otherwise it comes out of internal RAM.
+#ifndef PLOT_HISTORY_BITS
+#ifdef CONFIG_SPIRAM_SUPPORT
+    #define PLOT_HISTORY_BITS 14
+#else
+    #define PLOT_HISTORY_BITS 9
+#endif
+#endif
+    #define PLOT_HISTORY_LEN  (1 << PLOT_HISTORY_BITS)
+
+    // Plots binned automatically aim for at most this many points a
+    // second, their rate is measured over PLOT_RATE_WINDOW_MS
+#ifndef PLOT_POINT_RATE
+    #define PLOT_POINT_RATE     60
+#endif
+#ifndef PLOT_RATE_WINDOW_MS
+    #define PLOT_RATE_WINDOW_MS 250
+#endif
+    // With all MAX_PLOTS in use, a new plot replaces the one longest
+    // without samples, provided that has been at least this long
+#ifndef PLOT_IDLE_MS
+    #define PLOT_IDLE_MS        10000
+#endif
 
+    struct Range {
+      int min;
+      int max;
+    };
+
+    // Samples arriving faster than they can be shown are gathered into a
+    // bin first, and only a full bin becomes a point of history.
+    struct Bin {
+      int      min;
+      int      max;
+      int      last;
+      int64_t  sum;
+      uint32_t count;
+    };
+
+    // A plot keeps the last PLOT_HISTORY_LEN points in a ring plus a
+    // min/max pyramid over them: level L holds the range of each aligned
+    // block of 2^L points, so the range of any window of history takes
+    // O(log) lookups however many points it spans.  A point is the mean
+    // of its bin; the pyramid keeps the bin's extremes, so columns still
+    // show every spike.
     struct Plot {
       std::string name;
       char        color;
-      int         range;
+      uint32_t    range;      // max - min, at least 1
+      int64_t     yScale;     // pixels per sample step, 32 fraction bits
       int         min;
       int         max;
-      int         data [ MAX_PLOT_DATA_LEN ];
+      int*        data   = nullptr; // sample s is at data[s % PLOT_HISTORY_LEN], fixed point
+      Range*      levels = nullptr; // levels 1 .. PLOT_HISTORY_BITS, coarsest last
+      uint32_t    seq;       // samples shifted in so far
+      int         pending;   // samples shifted in since the last draw
+      int         drawnMin;  // scale the plot was last drawn with
+      int         drawnMax;
+      Bin         bin;
+      int         binWidth;  // samples per point
+      bool        autoBin;   // binWidth follows the arrival rate
+      uint32_t    arrivals;  // samples since the rate was last measured
+      uint32_t    lastSample; // us, as of the updateRates() before it
       
-      void init   ( const std::string& newName = "" );
-      void update ( void );
-      void shift  ( int newData );
-      void shift  ( void );
+      bool  init   ( const std::string& newName = "" );
+      bool  add    ( int sample );   // true if it completed a point
+      void  shift  ( int newData, int lo, int hi );  // O(log PLOT_HISTORY_LEN)
+      void  shift  ( int newData ) { shift( newData, newData, newData ); }
+      void  scale  ( int span, int height ); // fits the last span samples to height pixels
+      Range query  ( uint32_t first, uint32_t count ) const;
+      int   at     ( uint32_t s ) const { return data[ s & (PLOT_HISTORY_LEN - 1) ]; }
+      Range* level ( int l ) const {
+        return levels + PLOT_HISTORY_LEN - (PLOT_HISTORY_LEN >> (l - 1));
+      }
     };
     
+    // Plots are found by name once, the ingest path then carries the id
+    // (the plot's slot), which stays valid until a plot is removed.
+    int  plotId       ( StrView plotName, bool create = true ); // -1 if none
+    bool addData      ( int id, int newData );  // true if there is a new point to draw
+    void setBinWidth  ( int id, int samples );  // 0 to follow the arrival rate
+    void updateRates  ( uint32_t nowUs );       // retunes the automatic bins, before adding data
+    // changes whenever ids kept from plotId() may have gone stale
+    uint32_t generation ( void ) const { return _generation; }
+    int         numPlots ( void ) const { return _numPlots; }
+    const Plot& plot     ( int id ) const { return _plots[id]; } // id from plotId()
+
     void shiftPlots   ( void ); // left shifts each plot by 1 element
     void clearPlots   ( void );
     void drawPlots    ( void );
     void drawPlot     ( Plot* plot );
-    void addData      ( std::string& plotName, int newData );
-    int  createPlot   ( std::string& plotName, bool overWrite = false );
-    void removePlot   ( std::string& plotName );
+    void drawSegment  ( Plot* plot, int i,   // line from point i-1 to i,
+                        int xMin = 0, int xMax = DISPLAY_WIDTH - 1 ); // only these columns
+    void drawColumns  ( Plot* plot );        // min to max span per pixel column
+    void setSpan      ( int samples );
+    bool addData      ( StrView plotName, int newData );
+    int  createPlot   ( StrView plotName, bool overWrite = false );
+    void removePlot   ( StrView plotName );
     void removePlot   ( int index );
+    void removePlots  ( StrView prefix );   // every plot whose name starts with it
     
     protected:
-    int      getPlotIndex  ( std::string& plotName );
-    Plot*    getPlot       ( std::string& plotName );
-    bool     hasPlot       ( std::string& plotName );
+    int      getPlotIndex  ( StrView plotName );
+    Plot*    getPlot       ( StrView plotName );
+    bool     hasPlot       ( StrView plotName );
     
     private:
+    // spans wider than the window in pixels are drawn as columns
+    bool columnMode ( void ) { return _span > right - left; }
+    int  xStep      ( void ) { return (right - left) / _span; }
+    int  valueY     ( Plot* plot, int value );  // no division, see Plot::scale
+    int  plotY      ( Plot* plot, int i ); // i-th sample of the span
+    bool canScroll  ( int& steps );
+    int  idlestPlot ( void );  // -1 unless one has been quiet for PLOT_IDLE_MS
+
+    // Open addressing name index with linear probing, kept at most half
+    // full.  Slots hold plot ids and the name's hash; the names themselves
+    // are only in the plots.
+    static const int indexSize = pow2AtLeast( 2 * MAX_PLOTS );
+
+    uint32_t hashName     ( StrView name );
+    int      findSlot     ( StrView name, uint32_t hash ); // name's slot or the free one ending its probe
+    void     rebuildIndex ( void );
+
+    int16_t  _index     [ indexSize ];  // -1 when free
+    uint32_t _indexHash [ indexSize ];
+    uint32_t _generation = 0;           // bumped by rebuildIndex()
+    uint32_t _rateStart  = 0;           // us, start of the rate window
+    uint32_t _now        = 0;           // us, as of the last updateRates()
+
     Plot _plots[ MAX_PLOTS ];
     int  _numPlots = 0;
+    int  _span     = DEFAULT_PLOT_SPAN;
+    bool _redraw   = true;  // window must be fully redrawn
    };
 
   class TextDisplay : public Window {
@@ -100,15 +287,22 @@ namespace DisplayTask {
     
     static const int maxLogs = 7;
     static const int logHeight = 12;
+    static const int maxLogLen = DISPLAY_WIDTH / FONT_8X12_ADVANCE; // characters of 8x12 font that fit
     
     void init     ( void );
     void clearLogs( void );
-    void addLog   ( const std::string& newLog );
+    void addLog   ( StrView newLog );  // copied, cut at maxLogLen
     void drawLogs ( void );
     
     private:
-    std::deque<std::string> _logs;
-    int                     _numLogs = 0;
+    void drawLog  ( int slot, int log );
+
+    // ring of the last maxLogs lines, _oldest is the next to be replaced
+    char _logs    [ maxLogs ][ maxLogLen ];
+    int  _logLen  [ maxLogs ];
+    int  _oldest  = 0;
+    int  _newLogs = 0;     // added since the last draw
+    bool _redraw  = true;  // pane must be fully redrawn
   };
 
   extern GraphDisplay graphDisplay;
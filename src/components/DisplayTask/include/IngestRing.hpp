@@ -0,0 +1,71 @@
+#ifndef __IngestRing__INCLUDE_GUARD
+#define __IngestRing__INCLUDE_GUARD
+
+#include <cstdint>
+#include <atomic>
+#include "LineParser.hpp"
+
+// bytes per ring, a power of two
+#ifndef INGEST_RING_SIZE
+#define INGEST_RING_SIZE 4096
+#endif
+
+namespace DisplayTask {
+
+  // Written by the producer only; the consumer may read them at any time.
+  struct IngestStats {
+    uint32_t messages;
+    uint32_t bytes;
+    uint32_t overflows;     // messages dropped because the ring was full
+    uint32_t droppedBytes;
+    uint32_t highWater;     // most bytes ever waiting
+  };
+
+  // Lock-free single producer / single consumer ring of messages in a
+  // fixed buffer.  Each message is a 16 bit length and a 32 bit time
+  // stamp followed by its bytes, padded to an even size.  A message never
+  // wraps: if it does not fit before the end of the buffer a wrap marker
+  // is left and it starts over at the front, so the consumer can parse it
+  // in place.
+  //
+  // The producer owns _head and the consumer owns _tail; each only
+  // publishes its own index (release) after it is done with the bytes.
+  class IngestRing {
+    public:
+    static const int size       = INGEST_RING_SIZE;
+    static const int header     = 6;
+    static const int maxMessage = size / 2 - header;  // longer pushes are split
+
+    IngestRing( void ) : _head(0), _tail(0), _peekEnd(0), _skip(0), _stats() {}
+
+    // producer: false if some of the data had to be dropped
+    bool push    ( const char* data, int len, uint32_t stamp = 0 );
+    // producer, for filling the ring straight from a driver: room for up
+    // to len bytes in one piece, nullptr if full; commit() what was used
+    char* reserve ( int& len );
+    void  commit  ( int len, uint32_t stamp = 0 );
+
+    // consumer: the oldest message, left in the ring until release()
+    bool peek    ( StrView& message, uint32_t* stamp = nullptr );
+    void release ( void );
+
+    int                used  ( void ) const;
+    const IngestStats& stats ( void ) const { return _stats; }
+
+    private:
+    bool pushMessage ( const char* data, int len, uint32_t stamp );
+    static uint32_t footprint ( int len ) { return (header + len + 1) & ~1u; }
+
+    static const uint16_t wrapMarker = 0xFFFF;
+
+    char                  _buf[ size ];
+    std::atomic<uint32_t> _head;     // bytes ever written, wraps
+    std::atomic<uint32_t> _tail;     // bytes ever consumed, wraps
+    uint32_t              _peekEnd;  // consumer only: _tail after release()
+    uint32_t              _skip;     // producer only: bytes reserve() left for a wrap
+    IngestStats           _stats;
+  };
+
+};
+
+#endif // __IngestRing__INCLUDE_GUARD
@@ -0,0 +1,111 @@
+#ifndef __LineParser__INCLUDE_GUARD
+#define __LineParser__INCLUDE_GUARD
+
+#include <cstdint>
+#include <string.h>
+#include <string>
+
+// Samples are fixed point numbers with this many fraction bits, so the
+// largest magnitude is 2^(31 - SAMPLE_FRAC_BITS)
+#ifndef SAMPLE_FRAC_BITS
+#define SAMPLE_FRAC_BITS 8
+#endif
+
+namespace DisplayTask {
+
+  // whole number to sample, saturating
+  inline int wholeToSample( int32_t v ) {
+    const int32_t limit = INT32_MAX >> SAMPLE_FRAC_BITS;
+    return v > limit ? INT32_MAX : v < -limit - 1 ? INT32_MIN : (int) ((uint32_t) v << SAMPLE_FRAC_BITS);
+  }
+
+  // Characters owned by someone else, the receive buffer or a std::string,
+  // so lines can be split and names looked up without copying them out.
+  struct StrView {
+    const char* data;
+    int         len;
+
+    StrView( void ) : data(""), len(0) {}
+    StrView( const char* d, int l ) : data(d), len(l) {}
+    StrView( const char* s ) : data(s), len(strlen(s)) {}
+    StrView( const std::string& s ) : data(s.data()), len(s.length()) {}
+
+    bool operator== ( const StrView& v ) const {
+      return v.len == len && memcmp( v.data, data, len ) == 0;
+    }
+    bool operator== ( const std::string& s ) const {
+      return *this == StrView( s );
+    }
+    bool startsWith ( const StrView& v ) const {
+      return v.len <= len && memcmp( v.data, data, v.len ) == 0;
+    }
+    StrView from ( int pos ) const {
+      return StrView( data + pos, len - pos );
+    }
+  };
+
+  struct ParseStats {
+    uint32_t lines;
+    uint32_t dataLines;
+    uint32_t samples;          // values on data lines, several per batch line
+    uint32_t commands;
+    uint32_t textLines;
+    uint32_t badValues;        // "name::value" whose value is not a number or too large
+    uint32_t unknownCommands;
+  };
+
+  struct Line {
+    enum Kind { TEXT, DATA, COMMAND };
+
+    Kind    kind;
+    StrView text;   // the whole line, without the line ending
+    StrView name;   // DATA: the plot name, COMMAND: what follows "+++"
+    int     value;  // DATA: the sample, in 1 / 2^SAMPLE_FRAC_BITS steps
+    StrView rest;   // DATA: the samples after this one, for nextSample()
+  };
+
+  // Splits a chunk of input into lines and classifies each in a single
+  // pass: a line holding "+++" is a command, one holding "::" followed by
+  // a number is plot data, anything else is text for the log.  Nothing is
+  // copied or allocated; the views point into the chunk, so they are only
+  // valid while it is.
+  //
+  // A data line may carry a batch: more values for the same plot after
+  // commas, and more "name::values" after semicolons,
+  //
+  //   a::1,2,3;b::4
+  //
+  // next() gives the first sample and nextSample() each of the others.
+  // Values beyond what a sample holds, +-2^(31 - SAMPLE_FRAC_BITS), are
+  // taken as the largest sample of their sign.
+  // If the chunk was cut short in the middle of a line, a value running
+  // into its end is not trusted.
+  class LineParser {
+    public:
+    LineParser( const char* data, int len, ParseStats& stats, bool cut = false )
+      : _pos(data), _end(data + len), _stats(stats), _cut(cut) {}
+
+    bool next       ( Line& line );  // false once the chunk is used up
+    // moves a DATA line on to its next sample, possibly of another plot;
+    // false at the end of the line or at a value that is not a number
+    bool nextSample ( Line& line );
+
+    // optional sign, digits, an optional fraction and an optional
+    // exponent, surrounding blanks allowed; gives the whole part,
+    // saturated like a sample, false if that is not all the view holds
+    static bool parseValue ( StrView text, int& value );
+
+    private:
+    // parses a value at p into a sample, saturating, leaving p after it
+    // and any blanks that follow
+    static bool scanValue  ( const char*& p, const char* end, int& value );
+
+    const char* _pos;
+    const char* _end;
+    ParseStats& _stats;
+    bool        _cut;
+  };
+
+};
+
+#endif // __LineParser__INCLUDE_GUARD
@@ -0,0 +1,89 @@
+#ifndef __StreamFramer__INCLUDE_GUARD
+#define __StreamFramer__INCLUDE_GUARD
+
+#include <cstdint>
+#include "LineParser.hpp"
+#include "BinaryProtocol.hpp"
+
+// longest record kept when a line is split across chunks, with room for
+// the largest binary frame
+#ifndef FRAMER_MAX_LINE
+#define FRAMER_MAX_LINE 260
+#endif
+
+// an unterminated line is taken as complete once its source has been
+// quiet this long, for senders that do not end every datagram with '\n'
+#ifndef FRAMER_IDLE_MS
+#define FRAMER_IDLE_MS 20
+#endif
+
+namespace DisplayTask {
+
+  struct FramerStats {
+    uint32_t records;
+    uint32_t joined;      // records put back together from several chunks
+    uint32_t overlong;    // records longer than FRAMER_MAX_LINE
+    uint32_t flushed;     // unterminated records flushed after FRAMER_IDLE_MS
+    uint32_t frames;      // binary frames, also counted in records
+    uint32_t cutFrames;   // binary frames dropped because their source went quiet
+  };
+
+  // Cuts the chunks one source delivers, at whatever boundaries the
+  // driver or the network chose, back into '\n' terminated records.
+  // Records that lie wholly inside a chunk are handed out in place, with
+  // their '\n'; only the start of a record that runs past the end of a
+  // chunk is copied, into a small carry buffer, and completed from the
+  // next one.
+  //
+  // A record starting with BINARY_MAGIC is a binary frame instead and
+  // runs for the length in its header, whatever bytes it holds.
+  //
+  // Records longer than FRAMER_MAX_LINE are either cut short and the rest
+  // of the line skipped (TRUNCATE), or handed out in FRAMER_MAX_LINE
+  // pieces (SPLIT).
+  class StreamFramer {
+    public:
+    static const int maxLine = FRAMER_MAX_LINE;
+
+    enum Overflow { TRUNCATE, SPLIT };
+
+    StreamFramer( Overflow policy = TRUNCATE )
+      : _pos(nullptr), _end(nullptr), _carryLen(0), _carryOut(false),
+        _skipping(false), _cut(false), _policy(policy), _stamp(0), _stats() {}
+
+    // starts on the next chunk, which must stay put until next() is false
+    void feed    ( const char* data, int len, uint32_t stamp = 0 );
+    // the next complete record, valid until the next call
+    bool next    ( StrView& record );
+    // hands out an unterminated record, once its source has gone quiet
+    bool flush   ( StrView& record );
+
+    bool     pending   ( void ) const { return (_carryLen > 0 && !_carryOut) || _skipping; }
+    bool     cut       ( void ) const { return _cut; }    // the last record was overlong
+    uint32_t lastStamp ( void ) const { return _stamp; }  // of the last chunk fed
+
+    const FramerStats& stats ( void ) const { return _stats; }
+
+    private:
+    bool nextFrame ( StrView& record );
+    bool carry     ( const char* data, int len );
+    bool takeCarry ( StrView& record );
+    bool inFrame   ( void ) const {
+      return _carryLen > 0 && (uint8_t) _carry[0] == BINARY_MAGIC;
+    }
+
+    const char* _pos;
+    const char* _end;
+    char        _carry[ maxLine ];
+    int         _carryLen;
+    bool        _carryOut;   // _carry was handed out, empty it on the next call
+    bool        _skipping;   // TRUNCATE: dropping the rest of an overlong line
+    bool        _cut;        // the record handed out last ends mid line
+    Overflow    _policy;
+    uint32_t    _stamp;
+    FramerStats _stats;
+  };
+
+};
+
+#endif // __StreamFramer__INCLUDE_GUARD
@@ -15,6 +15,13 @@ namespace SerialTask {
   #define EX_UART_NUM   UART_NUM_0
   #define BUF_SIZE      (1024)
 
+  static constexpr bool isLcdPin( int pin ) {
+    return pin == LCD_PIN_MISO || pin == LCD_PIN_MOSI || pin == LCD_PIN_CLK || pin == LCD_PIN_CS ||
+      pin == LCD_PIN_DC || pin == LCD_PIN_RST || pin == LCD_PIN_BCKL;
+  }
+  static_assert( !isLcdPin( SERIAL_RTS_PIN ), "SERIAL_RTS_PIN is wired to the LCD" );
+  static_assert( !isLcdPin( SERIAL_CTS_PIN ), "SERIAL_CTS_PIN is wired to the LCD" );
+
   void printInfo( void ) {
     printf("ESP Wireless Display\n");
     printf("--------------------\n");
@@ -24,70 +31,207 @@ namespace SerialTask {
     printf("\n");
     printf("Send text data to be displayed\n");
     printf("Any data that is not parsed as numeric data is text data\n");
+    printf("\n");
+    printf("Send +++STATS for the counters and any waiting log records\n");
   }
 
   static const char *TAG = "uart_events";
 
   static QueueHandle_t uart0_queue;
 
+  SerialStats serialStats = {};
+
+  // Newline positions the driver has reported, oldest first, relative to
+  // the next byte uart_read_bytes() returns.
+  static int  lineEnds[ SERIAL_PATTERN_QUEUE_LEN ];
+  static int  numLineEnds = 0;
+
+  static void collectLineEnds( void ) {
+    int pos;
+    while ( numLineEnds < SERIAL_PATTERN_QUEUE_LEN &&
+            (pos = uart_pattern_pop_pos(EX_UART_NUM)) != -1 )
+      lineEnds[ numLineEnds++ ] = pos;
+  }
+
+  // forgets the line ends within the len bytes just read
+  static void consumeLineEnds( int len ) {
+    int n = 0;
+    while ( n < numLineEnds && lineEnds[n] < len )
+      n++;
+    for (int i=n; i<numLineEnds; i++)
+      lineEnds[i - n] = lineEnds[i] - len;
+    numLineEnds -= n;
+  }
+
+  // Where the bytes read so far left off: at the start of a record, or
+  // inside a binary frame, whose payload may hold '\n' and "+++" and is
+  // skipped by its length rather than its line ends.
+  static bool lineStart = true;  // the next byte read starts a record
+  static int  frameHead = 0;     // header bytes of a frame seen while its length is not
+  static int  frameLeft = 0;     // bytes of the current frame still to come
+
+  // Moves the records starting with "+++" out of the len bytes just read
+  // and into the command lane, so they are never queued behind bulk data.
+  // Frames are stepped over by their length.  Text records are ended by
+  // memchr() rather than by the driver's line ends, which go missing when
+  // its pattern queue fills and would then let a record run into the next
+  // line or into a frame's payload.  Returns the bytes left for the serial
+  // ring.
+  static int liftCommands( char* data, int len ) {
+    using BinaryProtocol::header;
+    int removed = 0;  // bytes lifted so far, data after them has moved back
+    int pos = 0;
+    while ( pos < len ) {
+      char* record = data + pos - removed;
+      int   avail  = len - pos;
+      if ( frameHead > 0 ) {
+        // the rest of a frame header, the length is its last byte
+        int take = std::min( header - frameHead, avail );
+        frameHead += take;
+        pos += take;
+        if ( frameHead == header ) {
+          frameLeft = (uint8_t) record[ take - 1 ];
+          frameHead = 0;
+          lineStart = frameLeft == 0;
+        }
+        continue;
+      }
+      if ( frameLeft > 0 ) {
+        int take = std::min( frameLeft, avail );
+        frameLeft -= take;
+        pos += take;
+        lineStart = frameLeft == 0;
+        continue;
+      }
+      if ( lineStart && (uint8_t) record[0] == BINARY_MAGIC ) {
+        frameHead = 1;
+        pos++;
+        lineStart = false;
+        continue;
+      }
+      const char* nl = (const char*) memchr( record, '\n', avail );
+      if ( nl == nullptr ) {
+        // runs past this read
+        lineStart = false;
+        break;
+      }
+      int recLen = nl - record + 1;
+      if ( lineStart && recLen > 3 && memcmp( record, "+++", 3 ) == 0 ) {
+        DisplayTask::pushData( DisplayTask::INGEST_COMMAND, record, recLen );
+        memmove( record, record + recLen, avail - recLen );
+        removed += recLen;
+        serialStats.commands++;
+      }
+      pos += recLen;
+      lineStart = true;
+    }
+    return len - removed;
+  }
+
+  // Moves what the driver has buffered straight into the ingest ring, up
+  // to the end of the last complete record, so the display task gets
+  // whole lines and never has to carry one over to the next read.  The
+  // rest is read too if all is set, or if it is longer than any record
+  // could be, which means line ends were missed.  False if some of it has
+  // to wait because the ring is full.
+  static bool readBuffered( bool all ) {
+    collectLineEnds();
+    size_t buffered = 0;
+    uart_get_buffered_data_len(EX_UART_NUM, &buffered);
+    while (buffered > 0) {
+      int want = numLineEnds > 0 ? std::min( lineEnds[ numLineEnds - 1 ] + 1, (int) buffered ) : 0;
+      if ( all || (int) buffered - want > DisplayTask::StreamFramer::maxLine )
+        want = buffered;
+      if ( want == 0 )
+        break;
+      int len = want;
+      char* room = DisplayTask::reserveData( DisplayTask::INGEST_SERIAL, len );
+      if (room == nullptr) {
+        serialStats.ringFull++;
+        return false;
+      }
+      if ( len < want ) {
+        // not all of it fits, stop at a record end if there is one
+        int n = numLineEnds;
+        while ( n > 0 && lineEnds[n-1] >= len )
+          n--;
+        if ( n > 0 )
+          len = lineEnds[n-1] + 1;
+      }
+      len = uart_read_bytes(EX_UART_NUM, (uint8_t*) room, len, 0);
+      if (len <= 0)
+        break;
+      DisplayTask::commitData( DisplayTask::INGEST_SERIAL, liftCommands( room, len ) );
+      consumeLineEnds( len );
+      if ( !lineStart )
+        serialStats.partialReads++;
+      serialStats.bytes += len;
+      buffered -= std::min( buffered, (size_t) len );
+      collectLineEnds();
+    }
+    return true;
+  }
+
   static void uart_event_task(void *pvParameters)
   {
     uart_event_t event;
-    size_t buffered_size;
-    uint8_t* dtmp = (uint8_t*) malloc(BUF_SIZE);
+    bool behind  = false;  // bytes were left in the driver for want of room
+    bool partial = false;  // the start of a record is waiting for its end
     for(;;) {
-      //Waiting for UART event.
-      if(xQueueReceive(uart0_queue, (void * )&event, (portTickType)portMAX_DELAY)) {
-        ESP_LOGI(TAG, "uart[%d] event:", EX_UART_NUM);
+      //Waiting for UART event, for room in the ring while behind, or for
+      //the rest of a record.
+      TickType_t wait = behind ? MS_TO_TICKS(SERIAL_RETRY_MS) :
+        partial ? MS_TO_TICKS(SERIAL_PARTIAL_MS) : (portTickType)portMAX_DELAY;
+      bool timedOut = true;
+      if(xQueueReceive(uart0_queue, (void * )&event, wait)) {
+        timedOut = false;
         switch(event.type) {
             //Event of UART receving data
-            /*We'd better handler data event fast, there would be much more data events than
-                  other types of events. If we take too much time on data event, the queue might
-                  be full.
-                  in this example, we don't process data in event, but read data outside.*/
           case UART_DATA:
-            uart_get_buffered_data_len(EX_UART_NUM, &buffered_size);
-            ESP_LOGI(TAG, "data, len: %d; buffered len: %d", event.size, buffered_size);
+            serialStats.dataEvents++;
             break;
             //Event of HW FIFO overflow detected
           case UART_FIFO_OVF:
-            ESP_LOGI(TAG, "hw fifo overflow\n");
-            //If fifo overflow happened, you should consider adding flow control for your application.
-            //We can read data out out the buffer, or directly flush the rx buffer.
-            uart_flush(EX_UART_NUM);
+            serialStats.fifoOverflows++;
+            Diagnostics::log(Diagnostics::WARN, TAG, "hw fifo overflow");
             break;
             //Event of UART ring buffer full
           case UART_BUFFER_FULL:
-            ESP_LOGI(TAG, "ring buffer full\n");
-            //If buffer full happened, you should consider encreasing your buffer size
-            //We can read data out out the buffer, or directly flush the rx buffer.
-            uart_flush(EX_UART_NUM);
+            serialStats.bufferFull++;
+            Diagnostics::log(Diagnostics::WARN, TAG, "ring buffer full");
             break;
             //Event of UART RX break detected
           case UART_BREAK:
-            ESP_LOGI(TAG, "uart rx break\n");
+            serialStats.breaks++;
+            Diagnostics::log(Diagnostics::INFO, TAG, "uart rx break");
             break;
             //Event of UART parity check error
           case UART_PARITY_ERR:
-            ESP_LOGI(TAG, "uart parity error\n");
+            serialStats.parityErrors++;
+            Diagnostics::log(Diagnostics::WARN, TAG, "uart parity error");
             break;
             //Event of UART frame error
           case UART_FRAME_ERR:
-            ESP_LOGI(TAG, "uart frame error\n");
+            serialStats.frameErrors++;
+            Diagnostics::log(Diagnostics::WARN, TAG, "uart frame error");
             break;
-            //UART_PATTERN_DET
+            //UART_PATTERN_DET, a '\n' arrived, its position is collected below
           case UART_PATTERN_DET:
-            ESP_LOGI(TAG, "uart pattern detected\n");
             break;
             //Others
           default:
-            ESP_LOGI(TAG, "uart event type: %d\n", event.type);
+            Diagnostics::log(Diagnostics::INFO, TAG, "uart event type: %d", event.type);
             break;
         }
       }
+      // Whatever the event, take every complete record: what is left after
+      // an overflow is still good, so it is read rather than flushed.  A
+      // partial record is taken as well once nothing more has come for it.
+      behind = !readBuffered( timedOut && partial );
+      size_t buffered = 0;
+      uart_get_buffered_data_len(EX_UART_NUM, &buffered);
+      partial = buffered > 0;
     }
-    free(dtmp);
-    dtmp = NULL;
     vTaskDelete(NULL);
   }
 
@@ -103,28 +247,40 @@ namespace SerialTask {
     __state_delay__ = 100;
     state_State_1_setState();
     // execute the init transition for the initial state and task
+    Diagnostics::addCounter( "serial.bytes",         &serialStats.bytes );
+    Diagnostics::addCounter( "serial.dataEvents",    &serialStats.dataEvents );
+    Diagnostics::addCounter( "serial.fifoOverflows", &serialStats.fifoOverflows );
+    Diagnostics::addCounter( "serial.bufferFull",    &serialStats.bufferFull );
+    Diagnostics::addCounter( "serial.ringFull",      &serialStats.ringFull );
+    Diagnostics::addCounter( "serial.breaks",        &serialStats.breaks );
+    Diagnostics::addCounter( "serial.parityErrors",  &serialStats.parityErrors );
+    Diagnostics::addCounter( "serial.frameErrors",   &serialStats.frameErrors );
+    Diagnostics::addCounter( "serial.partialReads",  &serialStats.partialReads );
+    Diagnostics::addCounter( "serial.commands",      &serialStats.commands );
     uart_config_t uart_config = {
-      .baud_rate = 115200,
+      .baud_rate = SERIAL_BAUD_RATE,
       .data_bits = UART_DATA_8_BITS,
       .parity = UART_PARITY_DISABLE,
       .stop_bits = UART_STOP_BITS_1,
-      .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+      .flow_ctrl = SERIAL_FLOW_CONTROL ? UART_HW_FLOWCTRL_CTS_RTS : UART_HW_FLOWCTRL_DISABLE,
       .rx_flow_ctrl_thresh = 122,
     };
     //Set UART parameters
     uart_param_config(EX_UART_NUM, &uart_config);
-    //Set UART log level
-    esp_log_level_set(TAG, ESP_LOG_INFO);
     //Install UART driver, and get the queue.
-    uart_driver_install(EX_UART_NUM, BUF_SIZE * 2, BUF_SIZE * 2, 10, &uart0_queue, 0);
+    uart_driver_install(EX_UART_NUM, SERIAL_RX_BUF_SIZE, BUF_SIZE * 2, 10, &uart0_queue, 0);
 
-    //Set UART pins (using UART0 default pins ie no changes.)
-    uart_set_pin(EX_UART_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    //Set UART pins (using UART0 default pins ie no changes, RTS/CTS only with flow control.)
+    if (SERIAL_FLOW_CONTROL)
+      uart_set_pin(EX_UART_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, SERIAL_RTS_PIN, SERIAL_CTS_PIN);
+    else
+      uart_set_pin(EX_UART_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
 
-    //Set uart pattern detect function.
-    uart_enable_pattern_det_intr(EX_UART_NUM, '+', 3, 10000, 10, 10);
+    //Detect every '\n', so records can be read whole.
+    uart_enable_pattern_det_intr(EX_UART_NUM, '\n', 1, 10000, 0, 0);
+    uart_pattern_queue_reset(EX_UART_NUM, SERIAL_PATTERN_QUEUE_LEN);
     //Create a task to handler UART event from ISR
-    xTaskCreate(uart_event_task, "uart_event_task", 2048, NULL, 12, NULL);
+    xTaskCreate(uart_event_task, "uart_event_task", 3072, NULL, 12, NULL);
 
     // now loop running the state code
     while (true) {
@@ -157,21 +313,13 @@ namespace SerialTask {
       static uint8_t startupCounter = 0;
       static const uint8_t waitCounter = 10;
 
-      uint8_t data[BUF_SIZE];
-
+      // received data is read by uart_event_task as it arrives
       if (startupCounter == waitCounter) {
         printInfo();
         startupCounter++;
       }
       else if (startupCounter < waitCounter)
         startupCounter++;
-
-      memset(data, 0, BUF_SIZE);
-      int len = uart_read_bytes(EX_UART_NUM, data, BUF_SIZE, 0);//100 / portTICK_RATE_MS);
-      if (len > 0) {
-        std::string newData( (const char *)data );
-        DisplayTask::pushData(newData);
-      }
     }
   }
 
@@ -11,6 +11,42 @@
 #include "soc/uart_struct.h"
 
 #include "DisplayTask.hpp"
+#include "Diagnostics.hpp"
+
+// UART0 carries the console as well as the data to display
+#ifndef SERIAL_BAUD_RATE
+#define SERIAL_BAUD_RATE    115200
+#endif
+// RTS/CTS flow control, to run at 921600 baud and above without losing
+// bytes when the display falls behind
+#ifndef SERIAL_FLOW_CONTROL
+#define SERIAL_FLOW_CONTROL 0
+#endif
+// routed through the GPIO matrix to pins the LCD leaves free
+#ifndef SERIAL_RTS_PIN
+#define SERIAL_RTS_PIN      26
+#endif
+#ifndef SERIAL_CTS_PIN
+#define SERIAL_CTS_PIN      27
+#endif
+// driver receive buffer, about 90 ms at 921600 baud
+#ifndef SERIAL_RX_BUF_SIZE
+#define SERIAL_RX_BUF_SIZE  8192
+#endif
+// how often reading is retried while the ingest ring is full
+#ifndef SERIAL_RETRY_MS
+#define SERIAL_RETRY_MS     10
+#endif
+// newline positions the driver keeps between reads; when they run out
+// the reader falls back to taking whatever is buffered
+#ifndef SERIAL_PATTERN_QUEUE_LEN
+#define SERIAL_PATTERN_QUEUE_LEN 64
+#endif
+// how long the start of a record may sit in the driver waiting for its
+// '\n' before it is read anyway, for binary frames and unterminated text
+#ifndef SERIAL_PARTIAL_MS
+#define SERIAL_PARTIAL_MS   5
+#endif
 
 // Generated state functions and members for the task
 namespace SerialTask {
@@ -18,6 +54,20 @@ namespace SerialTask {
   // Task Forward Declarations
   extern bool changeState;
 
+  struct SerialStats {
+    uint32_t bytes;           // moved into the ingest ring
+    uint32_t dataEvents;
+    uint32_t fifoOverflows;   // the hardware FIFO overran, bytes were lost
+    uint32_t bufferFull;      // the driver buffer filled up, bytes were lost
+    uint32_t ringFull;        // reads put off because the ingest ring was full
+    uint32_t partialReads;    // reads that ended inside a record
+    uint32_t commands;        // "+++" lines moved to the command lane
+    uint32_t breaks;
+    uint32_t parityErrors;
+    uint32_t frameErrors;
+  };
+  extern SerialStats serialStats;
+
   // Generated task function
   void  taskFunction ( void *pvParameter );
 
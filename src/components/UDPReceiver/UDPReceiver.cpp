@@ -0,0 +1,221 @@
+#include "UDPReceiver.hpp"
+#include "esp_timer.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+extern "C" {
+  #include <sys/socket.h>
+#ifndef ESP_PLATFORM
+  // lwIP declares these in sys/socket.h
+  #include <sys/time.h>
+  #include <netinet/in.h>
+  #include <arpa/inet.h>
+#endif
+}
+
+#define MS_TO_TICKS( xTimeInMs ) (uint32_t)( ( ( TickType_t ) xTimeInMs * configTICK_RATE_HZ ) / ( TickType_t ) 1000 )
+
+namespace UDPReceiver {
+
+  UdpStats udpStats = {};
+
+  static uint32_t now_ms( void ) {
+    return (uint32_t) (esp_timer_get_time() / 1000);
+  }
+
+  int open( uint16_t port ) {
+    int sock = socket( AF_INET, SOCK_DGRAM, 0 );
+    if ( sock < 0 )
+      return -1;
+    struct sockaddr_in addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons( port );
+    addr.sin_addr.s_addr = htonl( INADDR_ANY );
+    if ( bind( sock, (struct sockaddr *) &addr, sizeof(addr) ) < 0 ) {
+      close( sock );
+      return -1;
+    }
+    // wake up at least once a window, so the rates fall when nothing comes
+    struct timeval timeout;
+    timeout.tv_sec  = UDP_RATE_WINDOW_MS / 1000;
+    timeout.tv_usec = (UDP_RATE_WINDOW_MS % 1000) * 1000;
+    setsockopt( sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout) );
+    return sock;
+  }
+
+  Source sources[ UDP_MAX_SOURCES ];
+
+  static void logSource( const char* fmt, int slot, const Source& source ) {
+    const uint8_t* ip = (const uint8_t*) &source.addr;
+    Diagnostics::log( Diagnostics::INFO, "udp", fmt, slot + 1, ip[0], ip[1], ip[2], ip[3] );
+  }
+
+  // The sender's slot, a new one if it is not in the table yet; -1 if
+  // every slot belongs to a sender that is still active.
+  static int findSource( const struct sockaddr_in& from, uint32_t now ) {
+    static int last = 0;  // datagrams mostly come in runs from one sender
+    const Source& hit = sources[last];
+    if ( hit.active && hit.addr == from.sin_addr.s_addr && hit.port == from.sin_port )
+      return last;
+    int slot = -1;
+    for (int i=0; i<UDP_MAX_SOURCES; i++) {
+      const Source& s = sources[i];
+      if ( s.active && s.addr == from.sin_addr.s_addr && s.port == from.sin_port )
+        return last = i;
+      // a free slot, or else the one quiet the longest
+      if ( slot == -1 || (sources[slot].active &&
+                          (!s.active || now - s.lastSeen > now - sources[slot].lastSeen)) )
+        slot = i;
+    }
+    Source& s = sources[slot];
+    if ( s.active ) {
+      if ( now - s.lastSeen < UDP_SOURCE_IDLE_MS )
+        return -1;
+      udpStats.sourcesEvicted++;
+      udpStats.sources--;
+    }
+    s.active     = true;
+    s.addr       = from.sin_addr.s_addr;
+    s.port       = from.sin_port;
+    s.generation = (s.generation + 1) & 0xFFFFFF;
+    s.datagrams  = s.bytes = s.windowDatagrams = s.windowBytes = 0;
+    s.packetsPerSec = s.bytesPerSec = 0;
+    udpStats.sourcesAdded++;
+    udpStats.sources++;
+    logSource( "source %d is %d.%d.%d.%d", slot, s );
+    return last = slot;
+  }
+
+  // rates over the window just ended, and senders gone quiet leave the table
+  static void endWindow( uint32_t now, uint32_t elapsed ) {
+    for (int i=0; i<UDP_MAX_SOURCES; i++) {
+      Source& s = sources[i];
+      if ( !s.active )
+        continue;
+      s.packetsPerSec   = (uint64_t) (s.datagrams - s.windowDatagrams) * 1000 / elapsed;
+      s.bytesPerSec     = (uint64_t) (s.bytes - s.windowBytes) * 1000 / elapsed;
+      s.windowDatagrams = s.datagrams;
+      s.windowBytes     = s.bytes;
+      if ( now - s.lastSeen >= UDP_SOURCE_IDLE_MS ) {
+        s.active = false;
+        udpStats.sourcesEvicted++;
+        udpStats.sources--;
+        logSource( "source %d (%d.%d.%d.%d) went quiet", i, s );
+      }
+    }
+  }
+
+  // one line per sender for "+++STATS"
+  static void reportSources( void ) {
+    uint32_t now = now_ms();
+    for (int i=0; i<UDP_MAX_SOURCES; i++) {
+      const Source& s = sources[i];
+      if ( !s.active )
+        continue;
+      const uint8_t* ip = (const uint8_t*) &s.addr;
+      printf( "udp.source.%d=%d.%d.%d.%d:%d datagrams=%u bytes=%u packetsPerSec=%u bytesPerSec=%u idleMs=%u\n",
+              i + 1, ip[0], ip[1], ip[2], ip[3], ntohs(s.port), s.datagrams, s.bytes,
+              s.packetsPerSec, s.bytesPerSec, now - s.lastSeen );
+    }
+  }
+
+  void receive( int sock ) {
+    uint32_t windowStart     = now_ms();
+    uint32_t windowDatagrams = udpStats.datagrams;
+    uint32_t windowBytes     = udpStats.bytes;
+    while ( true ) {
+      uint32_t now = now_ms();
+      if ( now - windowStart >= UDP_RATE_WINDOW_MS ) {
+        uint32_t elapsed = now - windowStart;
+        udpStats.packetsPerSec = (uint64_t) (udpStats.datagrams - windowDatagrams) * 1000 / elapsed;
+        udpStats.bytesPerSec   = (uint64_t) (udpStats.bytes - windowBytes) * 1000 / elapsed;
+        endWindow( now, elapsed );
+        windowStart     = now;
+        windowDatagrams = udpStats.datagrams;
+        windowBytes     = udpStats.bytes;
+      }
+
+      char* buffer = DisplayTask::acquireDatagram();
+      if ( buffer == nullptr ) {
+        // datagrams wait in the socket meanwhile; the display task wakes
+        // us when it releases a buffer, the timeout only keeps the rates
+        // going should it stop
+        udpStats.poolWaits++;
+        ulTaskNotifyTake( pdTRUE, MS_TO_TICKS(UDP_RATE_WINDOW_MS) );
+        continue;
+      }
+      struct sockaddr_in from;
+      socklen_t fromLen = sizeof(from);
+      int len = recvfrom( sock, buffer, DisplayTask::DatagramPool::bufferSize, 0,
+                          (struct sockaddr *) &from, &fromLen );
+      if ( len < 0 ) {
+        if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+          continue;
+        udpStats.recvErrors++;
+        Diagnostics::log( Diagnostics::ERROR, "udp", "recvfrom failed, errno %d", errno );
+        if ( errno == EBADF || errno == ENOTSOCK )
+          return;
+        vTaskDelay( MS_TO_TICKS(UDP_RETRY_MS) );
+        continue;
+      }
+      now = now_ms();
+      int slot = findSource( from, now );
+      if ( slot == -1 ) {
+        // the buffer is used again for the next datagram
+        udpStats.sourcesRejected++;
+        Diagnostics::log( Diagnostics::WARN, "udp", "source table full, datagram dropped" );
+        continue;
+      }
+      // the buffer has one byte more than the largest datagram we take;
+      // of a longer one only the whole lines are kept, so its cut off end
+      // is not joined to the start of the next
+      if ( len > UDP_MAX_DATAGRAM ) {
+        udpStats.truncated++;
+        len = UDP_MAX_DATAGRAM;
+        while ( len > 0 && buffer[ len - 1 ] != '\n' )
+          len--;
+        if ( len == 0 )
+          len = UDP_MAX_DATAGRAM;
+      }
+      Source& source = sources[slot];
+      source.lastSeen = now;
+      source.datagrams++;
+      source.bytes += len;
+      udpStats.datagrams++;
+      udpStats.bytes += len;
+      DisplayTask::submitDatagram( len, DisplayTask::senderTag( slot, source.generation ) );
+    }
+  }
+
+  static void receiveTask( void *pvParameter ) {
+    int sock = (int) (intptr_t) pvParameter;
+    receive( sock );
+    close( sock );
+    vTaskDelete( NULL );
+  }
+
+  bool start( uint16_t port ) {
+    int sock = open( port );
+    if ( sock < 0 ) {
+      Diagnostics::log( Diagnostics::ERROR, "udp", "cannot bind port %d, errno %d", port, errno );
+      return false;
+    }
+    Diagnostics::addCounter( "udp.datagrams",        &udpStats.datagrams );
+    Diagnostics::addCounter( "udp.bytes",            &udpStats.bytes );
+    Diagnostics::addCounter( "udp.truncated",        &udpStats.truncated );
+    Diagnostics::addCounter( "udp.poolWaits",        &udpStats.poolWaits );
+    Diagnostics::addCounter( "udp.recvErrors",       &udpStats.recvErrors );
+    Diagnostics::addCounter( "udp.sources",          &udpStats.sources );
+    Diagnostics::addCounter( "udp.sourcesAdded",     &udpStats.sourcesAdded );
+    Diagnostics::addCounter( "udp.sourcesEvicted",   &udpStats.sourcesEvicted );
+    Diagnostics::addCounter( "udp.sourcesRejected",  &udpStats.sourcesRejected );
+    Diagnostics::addCounter( "udp.packetsPerSec",    &udpStats.packetsPerSec );
+    Diagnostics::addCounter( "udp.bytesPerSec",      &udpStats.bytesPerSec );
+    Diagnostics::addReporter( reportSources );
+    return xTaskCreate( receiveTask, "udp_receive", UDP_TASK_STACK, (void *) (intptr_t) sock,
+                        UDP_TASK_PRIORITY, NULL ) == pdPASS;
+  }
+
+};
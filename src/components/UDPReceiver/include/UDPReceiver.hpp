@@ -0,0 +1,81 @@
+#ifndef __UDPReceiver__INCLUDE_GUARD
+#define __UDPReceiver__INCLUDE_GUARD
+
+#include <cstdint>
+
+#include "DisplayTask.hpp"
+#include "Diagnostics.hpp"
+
+// Receives datagrams for the display in a task of its own, blocked in
+// recvfrom() until one arrives, straight into a buffer of the datagram
+// pool that the display task then parses in place.  Only BSD sockets and
+// task creation are used, so it builds against lwIP as well as against
+// the host's sockets.
+
+// packet and byte rates are measured over this window, which is also the
+// longest recvfrom() blocks
+#ifndef UDP_RATE_WINDOW_MS
+#define UDP_RATE_WINDOW_MS 1000
+#endif
+// pause before receiving again after recvfrom() failed
+#ifndef UDP_RETRY_MS
+#define UDP_RETRY_MS       2
+#endif
+// a sender quiet this long gives up its slot in the source table
+#ifndef UDP_SOURCE_IDLE_MS
+#define UDP_SOURCE_IDLE_MS 10000
+#endif
+#ifndef UDP_TASK_PRIORITY
+#define UDP_TASK_PRIORITY  5
+#endif
+// lwIP's recvfrom() and the log calls need more than the minimum
+#ifndef UDP_TASK_STACK
+#define UDP_TASK_STACK     4096
+#endif
+
+namespace UDPReceiver {
+
+  struct UdpStats {
+    uint32_t datagrams;
+    uint32_t bytes;
+    uint32_t truncated;       // longer than UDP_MAX_DATAGRAM, only its first whole lines were kept
+    uint32_t poolWaits;       // receives put off because every buffer was in use
+    uint32_t recvErrors;
+    uint32_t sources;         // senders in the source table
+    uint32_t sourcesAdded;
+    uint32_t sourcesEvicted;  // idle for UDP_SOURCE_IDLE_MS
+    uint32_t sourcesRejected; // datagrams dropped because the table was full of active senders
+    uint32_t packetsPerSec;   // over the last UDP_RATE_WINDOW_MS
+    uint32_t bytesPerSec;
+  };
+  extern UdpStats udpStats;
+
+  // Every sender has a slot in the source table, found by its address
+  // and port, and its datagrams are tagged with it so the display task
+  // frames each sender apart and keeps its plots apart.  Only the
+  // receive task writes the table.
+  struct Source {
+    bool     active;
+    uint32_t addr;             // network byte order
+    uint16_t port;             // network byte order
+    uint32_t generation;       // bumped whenever the slot gets a new sender
+    uint32_t lastSeen;         // ms
+    uint32_t datagrams;
+    uint32_t bytes;
+    uint32_t packetsPerSec;    // over the last UDP_RATE_WINDOW_MS
+    uint32_t bytesPerSec;
+    uint32_t windowDatagrams;  // at the start of the rate window
+    uint32_t windowBytes;
+  };
+  extern Source sources[ UDP_MAX_SOURCES ];
+
+  // opens a socket bound to port on every interface, -1 on failure
+  int  open    ( uint16_t port );
+  // receives on sock until it fails, from the calling task
+  void receive ( int sock );
+  // opens the socket and starts the receive task, false on failure
+  bool start   ( uint16_t port );
+
+};
+
+#endif // __UDPReceiver__INCLUDE_GUARD
@@ -13,10 +13,6 @@ namespace WirelessTask {
     #include <sys/socket.h>
   }
 
-  static int mysocket;
-
-  static struct sockaddr_in remote_addr;
-  static unsigned int socklen;
 
   static esp_err_t event_handler(void *ctx, system_event_t *event)
   {
@@ -36,8 +32,8 @@ namespace WirelessTask {
         ESP_LOGI(TAG, "got ip:%s\n",
                  ip4addr_ntoa(&event->event_info.got_ip.ip_info.ip));
         ipStr = std::string("IP: ") + ip4addr_ntoa(&event->event_info.got_ip.ip_info.ip);
-        ipStr += ":" + std::to_string(EXAMPLE_DEFAULT_PORT);
-        DisplayTask::pushData( ipStr );
+        ipStr += ":" + std::to_string(EXAMPLE_DEFAULT_PORT) + "\n";
+        DisplayTask::pushData( DisplayTask::INGEST_SYSTEM, ipStr.data(), ipStr.length() );
         xEventGroupSetBits(udp_event_group, WIFI_CONNECTED_BIT);
         break;
       case SYSTEM_EVENT_AP_STACONNECTED:
@@ -99,45 +95,16 @@ namespace WirelessTask {
     wifi_init_softap();
     #endif
 
-    /*create udp socket*/
-    int socket_ret;
-
     ESP_LOGI(TAG, "create udp server after 3s...");
     vTaskDelay(3000 / portTICK_RATE_MS);
+    /*receive in a task of its own, blocked until a datagram arrives*/
     ESP_LOGI(TAG, "create_udp_server.");
-    socket_ret=create_udp_server();
-
-    if(socket_ret == ESP_FAIL) {
+    if (!UDPReceiver::start(EXAMPLE_DEFAULT_PORT)) {
       ESP_LOGI(TAG, "create udp socket error,stop.");
       vTaskDelete(NULL);
     }
-
-    /*create a task to tx/rx data*/
-    //TaskHandle_t tx_rx_task;
-    //xTaskCreate(&send_recv_data, "send_recv_data", 4096, NULL, 4, &tx_rx_task);
-
-    /*waiting udp connected success*/
-    //xEventGroupWaitBits(udp_event_group, UDP_CONNCETED_SUCCESS,false, true, portMAX_DELAY);
-    //ESP_LOGI(TAG, "udp connected");
-
-    int len;
-    char databuff[EXAMPLE_DEFAULT_PKTSIZE];
-
-    /*send&receive first packet*/
-    socklen = sizeof(remote_addr);
-
-    ESP_LOGI(TAG, "first recvfrom:");
-    len = recvfrom(mysocket, databuff, EXAMPLE_DEFAULT_PKTSIZE, 0, (struct sockaddr *)&remote_addr, &socklen);
-
-    if (len > 0) {
-      ESP_LOGI(TAG, "transfer data with %s:%u\n",
-               inet_ntoa(remote_addr.sin_addr), ntohs(remote_addr.sin_port));
-      xEventGroupSetBits(udp_event_group, UDP_CONNCETED_SUCCESS);
-    } else {
-      show_socket_error_reason(mysocket);
-      close(mysocket);
-      vTaskDelete(NULL);
-    } /*if (len > 0)*/
+    // nothing is left for the state loop to poll
+    __state_delay__ = 1000;
 
     // now loop running the state code
     while (true) {
@@ -166,23 +133,6 @@ namespace WirelessTask {
 
     // execute all substates
 
-    if (!__change_state__) {
-      int len;
-      char databuff[EXAMPLE_DEFAULT_PKTSIZE];
-      memset( databuff, 0, EXAMPLE_DEFAULT_PKTSIZE );
-      len = recvfrom(mysocket, databuff, EXAMPLE_DEFAULT_PKTSIZE, 0, (struct sockaddr *)&remote_addr, &socklen);
-      if (len > 0) {
-        ESP_LOGI(TAG, "transfer data with %s:%u\n",
-                 inet_ntoa(remote_addr.sin_addr), ntohs(remote_addr.sin_port));
-        ESP_LOGI(TAG, " received: %s", databuff);
-        std::string newData( (const char *)databuff );
-        DisplayTask::pushData( newData );
-      } else {
-        if (LOG_LOCAL_LEVEL >= ESP_LOG_DEBUG) {
-          show_socket_error_reason(mysocket);
-        }
-      } /*if (len > 0)*/
-    }
   }
 
   void state_State_1_setState( void ) {
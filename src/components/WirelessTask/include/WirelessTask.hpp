@@ -5,6 +5,7 @@
 
 // Task Includes
 #include "DisplayTask.hpp"
+#include "UDPReceiver.hpp"
 
 extern "C" {
   #include "UDPServer.h"
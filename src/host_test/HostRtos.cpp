@@ -0,0 +1,187 @@
+// FreeRTOS and esp_timer on the host: every task is a thread, task
+// notifications and queues are built on a mutex and condition variable,
+// and a tick is a millisecond.
+//
+// Threads started by xTaskCreate() are never joined, FreeRTOS tasks do
+// not return.  Tests that start any end with hostExit(), which leaves
+// without running static destructors the threads may still be using.
+
+#include "HostTest.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <string.h>
+#include <unistd.h>
+
+static const std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+double hostSeconds( void ) {
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - hostStart ).count();
+}
+
+void hostExit( int status ) {
+  fflush( stdout );
+  fflush( stderr );
+  _exit( status );
+}
+
+static std::chrono::milliseconds ticksToMs( TickType_t ticks ) {
+  return std::chrono::milliseconds( (uint64_t) ticks * 1000 / configTICK_RATE_HZ );
+}
+
+namespace {
+
+  struct Task {
+    std::mutex              lock;
+    std::condition_variable notified;
+    uint32_t                notifications = 0;
+  };
+
+  // ends the calling task from vTaskDelete( NULL )
+  struct TaskDeleted {};
+
+  struct Queue {
+    std::mutex              lock;
+    std::condition_variable changed;
+    std::deque< std::vector<uint8_t> > items;
+    UBaseType_t             length;
+    UBaseType_t             itemSize;
+  };
+
+}
+
+// every thread that calls into the task API gets one, tasks or not
+static thread_local Task* currentTask = nullptr;
+
+static Task* self( void ) {
+  if ( currentTask == nullptr )
+    currentTask = new Task();
+  return currentTask;
+}
+
+int64_t esp_timer_get_time( void ) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - hostStart ).count();
+}
+
+BaseType_t xTaskCreate( TaskFunction_t function, const char* name, uint32_t stackDepth,
+                        void* parameter, UBaseType_t priority, TaskHandle_t* handle ) {
+  (void) name;
+  (void) stackDepth;
+  (void) priority;
+  Task* task = new Task();
+  if ( handle != NULL )
+    *handle = task;
+  std::thread( [=] {
+      currentTask = task;
+      try {
+        function( parameter );
+      }
+      catch ( TaskDeleted& ) {
+      }
+    } ).detach();
+  return pdPASS;
+}
+
+void vTaskDelete( TaskHandle_t task ) {
+  if ( task == NULL || task == currentTask )
+    throw TaskDeleted();
+}
+
+void vTaskDelay( TickType_t ticks ) {
+  std::this_thread::sleep_for( ticksToMs( ticks ) );
+}
+
+TickType_t xTaskGetTickCount( void ) {
+  return (TickType_t) (esp_timer_get_time() * configTICK_RATE_HZ / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void ) {
+  return self();
+}
+
+uint32_t ulTaskNotifyTake( BaseType_t clearOnExit, TickType_t ticks ) {
+  Task* task = self();
+  std::unique_lock<std::mutex> lock( task->lock );
+  auto ready = [task] { return task->notifications > 0; };
+  if ( ticks == portMAX_DELAY )
+    task->notified.wait( lock, ready );
+  else
+    task->notified.wait_for( lock, ticksToMs( ticks ), ready );
+  uint32_t value = task->notifications;
+  if ( value > 0 )
+    task->notifications = clearOnExit ? 0 : value - 1;
+  return value;
+}
+
+BaseType_t xTaskNotifyGive( TaskHandle_t handle ) {
+  Task* task = (Task*) handle;
+  {
+    std::lock_guard<std::mutex> lock( task->lock );
+    task->notifications++;
+  }
+  task->notified.notify_one();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR( TaskHandle_t handle, BaseType_t* woken ) {
+  xTaskNotifyGive( handle );
+  if ( woken != NULL )
+    *woken = pdTRUE;
+}
+
+QueueHandle_t xQueueCreate( UBaseType_t length, UBaseType_t itemSize ) {
+  Queue* queue = new Queue();
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+
+BaseType_t xQueueSend( QueueHandle_t handle, const void* item, TickType_t ticks ) {
+  Queue* queue = (Queue*) handle;
+  std::unique_lock<std::mutex> lock( queue->lock );
+  auto room = [queue] { return queue->items.size() < queue->length; };
+  if ( ticks == portMAX_DELAY )
+    queue->changed.wait( lock, room );
+  else if ( !queue->changed.wait_for( lock, ticksToMs( ticks ), room ) )
+    return pdFAIL;
+  const uint8_t* bytes = (const uint8_t*) item;
+  queue->items.emplace_back( bytes, bytes + queue->itemSize );
+  queue->changed.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR( QueueHandle_t handle, const void* item, BaseType_t* woken ) {
+  if ( woken != NULL )
+    *woken = pdFALSE;
+  return xQueueSend( handle, item, 0 );
+}
+
+BaseType_t xQueueReceive( QueueHandle_t handle, void* item, TickType_t ticks ) {
+  Queue* queue = (Queue*) handle;
+  std::unique_lock<std::mutex> lock( queue->lock );
+  auto waiting = [queue] { return !queue->items.empty(); };
+  if ( ticks == portMAX_DELAY )
+    queue->changed.wait( lock, waiting );
+  else if ( !queue->changed.wait_for( lock, ticksToMs( ticks ), waiting ) )
+    return pdFALSE;
+  memcpy( item, queue->items.front().data(), queue->itemSize );
+  queue->items.pop_front();
+  queue->changed.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReset( QueueHandle_t handle ) {
+  Queue* queue = (Queue*) handle;
+  std::lock_guard<std::mutex> lock( queue->lock );
+  queue->items.clear();
+  queue->changed.notify_all();
+  return pdPASS;
+}
@@ -0,0 +1,55 @@
+#ifndef __HostTest__INCLUDE_GUARD
+#define __HostTest__INCLUDE_GUARD
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Checks shared by the host tests.  A failed CHECK prints where it was
+// and the test carries on; main() ends with hostResult(), which is the
+// exit status make test looks at.
+
+inline int& hostFailures( void ) {
+  static int failures = 0;
+  return failures;
+}
+
+inline bool hostCheck( bool ok, const char* what, const char* file, int line ) {
+  if ( !ok ) {
+    printf( "%s:%d: CHECK failed: %s\n", file, line, what );
+    hostFailures()++;
+  }
+  return ok;
+}
+
+#define CHECK( cond ) hostCheck( (cond), #cond, __FILE__, __LINE__ )
+
+// like CHECK, printing both values
+#define CHECK_EQ( a, b ) do {                                            \
+    long long _a = (long long) (a), _b = (long long) (b);               \
+    if ( !hostCheck( _a == _b, #a " == " #b, __FILE__, __LINE__ ) )     \
+      printf( "    %lld != %lld\n", _a, _b );                           \
+  } while ( 0 )
+
+inline int hostResult( void ) {
+  if ( hostFailures() > 0 )
+    printf( "%d check(s) failed\n", hostFailures() );
+  return hostFailures() > 0 ? 1 : 0;
+}
+
+// wall clock seconds since the test started
+double hostSeconds( void );
+
+// ends a test that started tasks, see HostRtos.cpp
+void hostExit( int status );
+
+// the end of the pty a test writes to, the serial task reads the other
+// through driver/uart.h; waits for uart_driver_install(), see HostUart.cpp
+int hostUartSender( void );
+
+// keeps a benchmark's result from being optimized away
+template <typename T>
+inline void hostKeep( const T& value ) {
+  __asm__ __volatile__( "" : : "g"(&value) : "memory" );
+}
+
+#endif // __HostTest__INCLUDE_GUARD
@@ -0,0 +1,187 @@
+// The UART driver on the host: the serial task reads one end of a pseudo
+// terminal, a test writes the other through hostUartSender().  A thread
+// stands in for the receive interrupt.  It moves bytes a FIFO's worth at
+// a time into the driver buffer, notes every pattern character's position
+// and posts UART_DATA and UART_PATTERN_DET events.  With RTS/CTS it stops
+// reading while the buffer is full, so the writer blocks as a sender
+// seeing CTS drop would; without, what does not fit is dropped and
+// UART_BUFFER_FULL posted, as the IDF driver does.
+
+#include "HostTest.hpp"
+#include "driver/uart.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+  struct Uart {
+    std::mutex              lock;
+    std::condition_variable changed;  // bytes arrived or were read
+    bool                    installed = false;
+    int                     sender    = -1;
+    int                     receiver  = -1;
+    QueueHandle_t           events    = nullptr;
+    bool                    flowControl = false;
+    std::deque<uint8_t>     buffer;
+    size_t                  bufferSize = 0;
+    char                    pattern   = 0;
+    bool                    detecting = false;
+    std::deque<int>         positions;  // relative to the next byte read
+    size_t                  maxPositions = 0;
+  };
+
+  Uart uart;
+
+  // what the hardware FIFO holds before it interrupts
+  const int fifoThreshold = 120;
+
+  void post( uart_event_type_t type, size_t size ) {
+    uart_event_t event = { type, size, false };
+    xQueueSendFromISR( uart.events, &event, NULL );
+  }
+
+  void receive( void ) {
+    uint8_t fifo[ fifoThreshold ];
+    for (;;) {
+      int len = read( uart.receiver, fifo, sizeof(fifo) );
+      if ( len <= 0 )
+        return;
+      int patterns = 0;
+      bool full = false;
+      {
+        std::unique_lock<std::mutex> lock( uart.lock );
+        if ( uart.flowControl )
+          uart.changed.wait( lock, [len] { return uart.buffer.size() + len <= uart.bufferSize; } );
+        else if ( uart.buffer.size() + len > uart.bufferSize )
+          full = true;
+        if ( !full ) {
+          for (int i=0; i<len; i++) {
+            if ( uart.detecting && (char) fifo[i] == uart.pattern ) {
+              patterns++;
+              if ( uart.positions.size() < uart.maxPositions )
+                uart.positions.push_back( (int) uart.buffer.size() );
+            }
+            uart.buffer.push_back( fifo[i] );
+          }
+        }
+        uart.changed.notify_all();
+      }
+      if ( full ) {
+        post( UART_BUFFER_FULL, 0 );
+        continue;
+      }
+      post( UART_DATA, len );
+      for (int i=0; i<patterns; i++)
+        post( UART_PATTERN_DET, 0 );
+    }
+  }
+
+}
+
+int hostUartSender( void ) {
+  std::unique_lock<std::mutex> lock( uart.lock );
+  uart.changed.wait( lock, [] { return uart.installed; } );
+  return uart.sender;
+}
+
+int uart_param_config( uart_port_t, const uart_config_t* config ) {
+  uart.flowControl = config->flow_ctrl == UART_HW_FLOWCTRL_CTS_RTS;
+  return 0;
+}
+
+int uart_driver_install( uart_port_t, int rxBufferSize, int, int queueSize,
+                         QueueHandle_t* queue, int ) {
+  int sender = posix_openpt( O_RDWR | O_NOCTTY );
+  if ( sender < 0 || grantpt( sender ) != 0 || unlockpt( sender ) != 0 )
+    return -1;
+  int receiver = open( ptsname( sender ), O_RDWR | O_NOCTTY );
+  if ( receiver < 0 )
+    return -1;
+  // raw, so '\n' and every other byte pass as they are
+  struct termios tio;
+  tcgetattr( receiver, &tio );
+  cfmakeraw( &tio );
+  tcsetattr( receiver, TCSANOW, &tio );
+  tcgetattr( sender, &tio );
+  cfmakeraw( &tio );
+  tcsetattr( sender, TCSANOW, &tio );
+
+  uart.events = xQueueCreate( queueSize, sizeof(uart_event_t) );
+  *queue = uart.events;
+  {
+    std::lock_guard<std::mutex> lock( uart.lock );
+    uart.sender = sender;
+    uart.receiver = receiver;
+    uart.bufferSize = rxBufferSize;
+    uart.installed = true;
+  }
+  uart.changed.notify_all();
+  std::thread( receive ).detach();
+  return 0;
+}
+
+int uart_set_pin( uart_port_t, int, int, int, int ) {
+  return 0;
+}
+
+int uart_enable_pattern_det_intr( uart_port_t, char patternChar, uint8_t, int, int, int ) {
+  std::lock_guard<std::mutex> lock( uart.lock );
+  uart.pattern = patternChar;
+  uart.detecting = true;
+  return 0;
+}
+
+int uart_pattern_queue_reset( uart_port_t, int queueLength ) {
+  std::lock_guard<std::mutex> lock( uart.lock );
+  uart.positions.clear();
+  uart.maxPositions = queueLength;
+  return 0;
+}
+
+int uart_pattern_pop_pos( uart_port_t ) {
+  std::lock_guard<std::mutex> lock( uart.lock );
+  if ( uart.positions.empty() )
+    return -1;
+  int pos = uart.positions.front();
+  uart.positions.pop_front();
+  return pos;
+}
+
+int uart_get_buffered_data_len( uart_port_t, size_t* size ) {
+  std::lock_guard<std::mutex> lock( uart.lock );
+  *size = uart.buffer.size();
+  return 0;
+}
+
+int uart_read_bytes( uart_port_t, uint8_t* buf, uint32_t length, TickType_t ticks ) {
+  std::unique_lock<std::mutex> lock( uart.lock );
+  if ( uart.buffer.empty() && ticks > 0 )
+    uart.changed.wait_for( lock, std::chrono::milliseconds( (uint64_t) ticks * 1000 / configTICK_RATE_HZ ),
+                           [] { return !uart.buffer.empty(); } );
+  int len = (int) std::min( (size_t) length, uart.buffer.size() );
+  std::copy( uart.buffer.begin(), uart.buffer.begin() + len, buf );
+  uart.buffer.erase( uart.buffer.begin(), uart.buffer.begin() + len );
+  // like the IDF driver, positions move along with what was read and
+  // those read past are forgotten
+  while ( !uart.positions.empty() && uart.positions.front() < len )
+    uart.positions.pop_front();
+  for (int& pos : uart.positions)
+    pos -= len;
+  uart.changed.notify_all();
+  return len;
+}
+
+int uart_flush_input( uart_port_t ) {
+  std::lock_guard<std::mutex> lock( uart.lock );
+  uart.buffer.clear();
+  uart.positions.clear();
+  uart.changed.notify_all();
+  return 0;
+}
@@ -0,0 +1,206 @@
+#include "MockPanel.hpp"
+#include "VramLayout.hpp"
+#include "HostTest.hpp"
+#include <string.h>
+#include <algorithm>
+
+namespace MockPanel {
+
+  uint16_t memory[ DISPLAY_HEIGHT ][ DISPLAY_WIDTH ];
+  uint16_t scrollTop, scrollHeight, scrollStart;
+  uint8_t  madctl;
+
+  static Stats    counts;
+  static double   bytesPerSecond = 0;
+  static bool     recording = false;
+  static std::vector<WireByte> wire;
+
+  // the command being sent and the parameters it got so far
+  static uint8_t  command;
+  static uint8_t  params[ 8 ];
+  static int      numParams;
+  // address window and where the next pixel goes
+  static int      x0, x1 = DISPLAY_WIDTH - 1, y0, y1 = DISPLAY_HEIGHT - 1;
+  static int      px, py;
+
+  // the burst on the wire, lands in memory when it is done
+  static const uint32_t* burst = nullptr;
+  static int             burstPixels;
+  static double          burstEnd;
+
+  static void putPixel( uint16_t color ) {
+    if ( py > y1 ) {
+      counts.outOfWindow++;
+      return;
+    }
+    memory[py][px] = color;
+    counts.firstRow = std::min( counts.firstRow, py );
+    counts.lastRow  = std::max( counts.lastRow, py );
+    if ( ++px > x1 ) {
+      px = x0;
+      py++;
+    }
+  }
+
+  static void land( const uint32_t* words, int pixels ) {
+    // pixel k is half word k, high byte first on the wire
+    const uint8_t* bytes = (const uint8_t*) words;
+    for (int k=0; k<pixels; k++) {
+      putPixel( bytes[2*k] << 8 | bytes[2*k + 1] );
+      if ( recording ) {
+        wire.push_back( { 1, bytes[2*k] } );
+        wire.push_back( { 1, bytes[2*k + 1] } );
+      }
+    }
+  }
+
+  static void finishBurst( void ) {
+    if ( burst == nullptr )
+      return;
+    double now = hostSeconds();
+    if ( now < burstEnd ) {
+      counts.waitSeconds += burstEnd - now;
+      while ( hostSeconds() < burstEnd )
+        ;
+    }
+    land( burst, burstPixels );
+    burst = nullptr;
+  }
+
+  static uint16_t param16( int i ) {
+    return params[i] << 8 | params[i + 1];
+  }
+
+  static void init( void ) {}
+  static void resetPanel( void ) {}
+  static void delayUs( const uint32_t ) {}
+
+  static void writeCommand( const uint8_t cmd ) {
+    finishBurst();
+    counts.commands++;
+    if ( recording )
+      wire.push_back( { 0, cmd } );
+    command = cmd;
+    numParams = 0;
+    if ( cmd == ILI9341_RAMWR ) {
+      counts.windows++;
+      px = x0;
+      py = y0;
+    }
+  }
+
+  static void writeData( const uint8_t* data, const uint32_t len ) {
+    finishBurst();
+    counts.dataBytes += len;
+    for (uint32_t i=0; i<len; i++) {
+      if ( recording )
+        wire.push_back( { 1, data[i] } );
+      if ( numParams < (int) sizeof(params) )
+        params[ numParams++ ] = data[i];
+    }
+    if ( command == ILI9341_CASET && numParams >= 4 ) {
+      x0 = param16(0);
+      x1 = param16(2);
+    }
+    else if ( command == ILI9341_PASET && numParams >= 4 ) {
+      y0 = param16(0);
+      y1 = param16(2);
+    }
+    else if ( command == ILI9341_VSCRDEF && numParams >= 6 ) {
+      scrollTop = param16(0);
+      scrollHeight = param16(2);
+    }
+    else if ( command == ILI9341_VSCRSADD && numParams >= 2 ) {
+      scrollStart = param16(0);
+    }
+    else if ( command == ILI9341_MADCTL && numParams >= 1 ) {
+      madctl = params[0];
+    }
+  }
+
+  static void writePixels( const uint32_t* words, const int numPixels ) {
+    finishBurst();
+    counts.bursts++;
+    counts.pixels += numPixels;
+    counts.dataBytes += numPixels * 2;
+    if ( bytesPerSecond == 0 ) {
+      land( words, numPixels );
+      return;
+    }
+    burst = words;
+    burstPixels = numPixels;
+    burstEnd = hostSeconds() + numPixels * 2 / bytesPerSecond;
+  }
+
+  static void wait( void ) {
+    finishBurst();
+  }
+
+  const lcd_bus_s bus = {
+    init,
+    resetPanel,
+    delayUs,
+    writeCommand,
+    writeData,
+    writePixels,
+    wait,
+    LCD_PIXEL_BUF_LEN
+  };
+
+  void reset( void ) {
+    memset( memory, 0, sizeof(memory) );
+    scrollTop = 0;
+    scrollHeight = DISPLAY_HEIGHT;
+    scrollStart = 0;
+    madctl = 0;
+    resetStats();
+  }
+
+  Stats stats( void ) {
+    return counts;
+  }
+
+  void resetStats( void ) {
+    memset( &counts, 0, sizeof(counts) );
+    counts.firstRow = DISPLAY_HEIGHT;
+    counts.lastRow  = -1;
+  }
+
+  void setBytesPerSecond( double rate ) {
+    bytesPerSecond = rate;
+  }
+
+  void record( bool on ) {
+    recording = on;
+  }
+
+  const std::vector<WireByte>& trace( void ) {
+    return wire;
+  }
+
+  void clearTrace( void ) {
+    wire.clear();
+  }
+
+  uint16_t vramColor( int x, int y ) {
+    return myPalette[ vram[ vram_layout::index( x, y ) ] ];
+  }
+
+  int mismatches( void ) {
+    int bad = 0;
+    for (int y=0; y<DISPLAY_HEIGHT; y++)
+      for (int x=0; x<DISPLAY_WIDTH; x++)
+        if ( memory[y][x] != vramColor( x, y ) )
+          bad++;
+    return bad;
+  }
+
+  uint16_t shown( int x, int y ) {
+    if ( y >= scrollTop && y < scrollTop + scrollHeight ) {
+      int line = (y - scrollTop + scrollStart - scrollTop) % scrollHeight;
+      y = scrollTop + (line < 0 ? line + scrollHeight : line);
+    }
+    return memory[y][x];
+  }
+
+};
@@ -0,0 +1,69 @@
+#ifndef __MockPanel__INCLUDE_GUARD
+#define __MockPanel__INCLUDE_GUARD
+
+#include <stdint.h>
+#include <vector>
+#include "Display.hpp"
+
+// An ILI9341 on the host: a bus for lcd_set_bus() that follows the
+// address windows, memory writes and scroll registers the display code
+// sends, so what the panel would show can be compared with vram.  Bus
+// traffic is counted, and pixel bursts can be given the time they would
+// take on the wire.
+namespace MockPanel {
+
+  struct Stats {
+    uint32_t commands;
+    uint32_t windows;      // memory writes started (RAMWR)
+    uint32_t bursts;       // write_pixels() calls
+    uint32_t pixels;
+    uint32_t dataBytes;    // parameters and pixels
+    uint32_t outOfWindow;  // pixels sent past the end of their window
+    int      firstRow;     // memory lines pixels landed on, none while
+    int      lastRow;      // firstRow > lastRow
+    double   waitSeconds;  // blocked in the bus for a burst to go out
+  };
+
+  // one byte on the wire, dc is 0 for commands and 1 for data
+  struct WireByte {
+    uint8_t dc;
+    uint8_t value;
+    bool operator== ( const WireByte& b ) const { return dc == b.dc && value == b.value; }
+  };
+
+  extern const lcd_bus_s bus;
+
+  // panel memory, in RGB565 as sent
+  extern uint16_t memory[ DISPLAY_HEIGHT ][ DISPLAY_WIDTH ];
+  // as last set by VSCRDEF and VSCRSADD
+  extern uint16_t scrollTop, scrollHeight, scrollStart;
+  // as last set by MADCTL
+  extern uint8_t  madctl;
+
+  void  reset      ( void );  // memory, scroll registers and stats
+  Stats stats      ( void );
+  void  resetStats ( void );
+
+  // 0 (the default) lands every burst in memory at once.  Otherwise a
+  // burst takes its bytes at this rate and only lands when the next bus
+  // call has waited for it, so a buffer the caller refills too early
+  // shows up as wrong pixels.
+  void setBytesPerSecond ( double rate );
+
+  // keeps every byte sent from now on in trace()
+  void                          record ( bool on );
+  const std::vector<WireByte>&  trace  ( void );
+  void                          clearTrace ( void );
+
+  // the color vram holds for pixel x,y, and the pixels where panel
+  // memory differs from it
+  uint16_t vramColor  ( int x, int y );
+  int      mismatches ( void );
+
+  // the color on the glass at x,y: lines in the scrolling area are read
+  // from memory starting at line scrollStart, wrapping within the area
+  uint16_t shown      ( int x, int y );
+
+};
+
+#endif // __MockPanel__INCLUDE_GUARD
@@ -0,0 +1,6 @@
+#ifndef __HostGpio__INCLUDE_GUARD
+#define __HostGpio__INCLUDE_GUARD
+
+typedef int gpio_num_t;
+
+#endif // __HostGpio__INCLUDE_GUARD
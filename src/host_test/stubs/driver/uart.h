@@ -0,0 +1,75 @@
+#ifndef __HostUart__INCLUDE_GUARD
+#define __HostUart__INCLUDE_GUARD
+
+// The parts of the ESP-IDF UART driver the serial task uses, implemented
+// over a pseudo terminal by HostUart.cpp.
+
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int uart_port_t;
+#define UART_NUM_0 0
+#define UART_NUM_1 1
+#define UART_NUM_2 2
+
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef enum {
+  UART_DATA,
+  UART_BREAK,
+  UART_BUFFER_FULL,
+  UART_FIFO_OVF,
+  UART_FRAME_ERR,
+  UART_PARITY_ERR,
+  UART_DATA_BREAK,
+  UART_PATTERN_DET,
+  UART_EVENT_MAX
+} uart_event_type_t;
+
+typedef struct {
+  uart_event_type_t type;
+  size_t            size;
+  bool              timeout_flag;
+} uart_event_t;
+
+typedef enum { UART_DATA_5_BITS, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5 = 2, UART_STOP_BITS_2 = 3 } uart_stop_bits_t;
+typedef enum {
+  UART_HW_FLOWCTRL_DISABLE,
+  UART_HW_FLOWCTRL_RTS,
+  UART_HW_FLOWCTRL_CTS,
+  UART_HW_FLOWCTRL_CTS_RTS
+} uart_hw_flowcontrol_t;
+
+typedef struct {
+  int                   baud_rate;
+  uart_word_length_t    data_bits;
+  uart_parity_t         parity;
+  uart_stop_bits_t      stop_bits;
+  uart_hw_flowcontrol_t flow_ctrl;
+  uint8_t               rx_flow_ctrl_thresh;
+} uart_config_t;
+
+int uart_param_config( uart_port_t port, const uart_config_t* config );
+int uart_driver_install( uart_port_t port, int rxBufferSize, int txBufferSize,
+                         int queueSize, QueueHandle_t* queue, int intrAllocFlags );
+int uart_set_pin( uart_port_t port, int tx, int rx, int rts, int cts );
+int uart_enable_pattern_det_intr( uart_port_t port, char patternChar, uint8_t count,
+                                  int gapTimeout, int postIdle, int preIdle );
+int uart_pattern_queue_reset( uart_port_t port, int queueLength );
+int uart_pattern_pop_pos( uart_port_t port );
+int uart_get_buffered_data_len( uart_port_t port, size_t* size );
+int uart_read_bytes( uart_port_t port, uint8_t* buf, uint32_t length, TickType_t ticks );
+int uart_flush_input( uart_port_t port );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HostUart__INCLUDE_GUARD
@@ -0,0 +1,11 @@
+#ifndef __HostEspLog__INCLUDE_GUARD
+#define __HostEspLog__INCLUDE_GUARD
+
+#include <stdio.h>
+
+#define ESP_LOGE( tag, fmt, ... ) printf( "E %s: " fmt "\n", tag, ##__VA_ARGS__ )
+#define ESP_LOGW( tag, fmt, ... ) printf( "W %s: " fmt "\n", tag, ##__VA_ARGS__ )
+#define ESP_LOGI( tag, fmt, ... ) printf( "I %s: " fmt "\n", tag, ##__VA_ARGS__ )
+#define ESP_LOGD( tag, fmt, ... ) do {} while ( 0 )
+
+#endif // __HostEspLog__INCLUDE_GUARD
@@ -0,0 +1,17 @@
+#ifndef __HostEspTimer__INCLUDE_GUARD
+#define __HostEspTimer__INCLUDE_GUARD
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// microseconds since the test started
+int64_t esp_timer_get_time( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HostEspTimer__INCLUDE_GUARD
@@ -0,0 +1,29 @@
+#ifndef __HostFreeRTOS__INCLUDE_GUARD
+#define __HostFreeRTOS__INCLUDE_GUARD
+
+// Host stand-in for the FreeRTOS types and macros the components use.
+// Tasks are threads, see HostRtos.cpp.
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef TickType_t portTickType;
+
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define portMAX_DELAY       ((TickType_t) 0xffffffff)
+#define portTICK_PERIOD_MS  (1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS    portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)   ((TickType_t) (((TickType_t) (ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdFAIL  0
+#define pdPASS  1
+
+#define IRAM_ATTR
+
+#endif // __HostFreeRTOS__INCLUDE_GUARD
@@ -0,0 +1,10 @@
+#ifndef __HostEventGroups__INCLUDE_GUARD
+#define __HostEventGroups__INCLUDE_GUARD
+
+// included by DisplayTask.hpp, nothing in the host build uses event groups
+#include "FreeRTOS.h"
+
+typedef void*    EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#endif // __HostEventGroups__INCLUDE_GUARD
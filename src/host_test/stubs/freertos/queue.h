@@ -0,0 +1,22 @@
+#ifndef __HostQueue__INCLUDE_GUARD
+#define __HostQueue__INCLUDE_GUARD
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void* QueueHandle_t;
+
+QueueHandle_t xQueueCreate( UBaseType_t length, UBaseType_t itemSize );
+BaseType_t    xQueueSend( QueueHandle_t queue, const void* item, TickType_t ticks );
+BaseType_t    xQueueSendFromISR( QueueHandle_t queue, const void* item, BaseType_t* woken );
+BaseType_t    xQueueReceive( QueueHandle_t queue, void* item, TickType_t ticks );
+BaseType_t    xQueueReset( QueueHandle_t queue );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HostQueue__INCLUDE_GUARD
@@ -0,0 +1,9 @@
+#ifndef __HostSemphr__INCLUDE_GUARD
+#define __HostSemphr__INCLUDE_GUARD
+
+// included by DisplayTask.hpp, nothing in the host build takes a semaphore
+#include "queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#endif // __HostSemphr__INCLUDE_GUARD
@@ -0,0 +1,30 @@
+#ifndef __HostTask__INCLUDE_GUARD
+#define __HostTask__INCLUDE_GUARD
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)( void* );
+
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY   0x7FFFFFFF
+
+BaseType_t   xTaskCreate( TaskFunction_t function, const char* name, uint32_t stackDepth,
+                          void* parameter, UBaseType_t priority, TaskHandle_t* handle );
+void         vTaskDelete( TaskHandle_t task );
+void         vTaskDelay( TickType_t ticks );
+TickType_t   xTaskGetTickCount( void );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+uint32_t     ulTaskNotifyTake( BaseType_t clearOnExit, TickType_t ticks );
+BaseType_t   xTaskNotifyGive( TaskHandle_t task );
+void         vTaskNotifyGiveFromISR( TaskHandle_t task, BaseType_t* woken );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HostTask__INCLUDE_GUARD
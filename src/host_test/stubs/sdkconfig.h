@@ -0,0 +1,3 @@
+// Host build: the few options the components read.  ESP_PLATFORM is
+// left undefined, which keeps the ESP32 SPI code out of the build.
+#define CONFIG_FREERTOS_HZ 1000
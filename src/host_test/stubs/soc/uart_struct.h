@@ -0,0 +1 @@
+// included by SerialTask.hpp, the host build has no UART registers
@@ -0,0 +1,59 @@
+// Batch lines: the display task runs as it does on the board, against the
+// mock panel, while this thread feeds "name::v1,v2,..." lines into the
+// serial ring as fast as the ring takes them.  Samples per second for
+// batches of 1 to 64 values per line; every sample must reach the plot.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "DisplayTask.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+
+using namespace DisplayTask;
+
+static uint32_t appliedSamples( void ) {
+  return ((volatile DisplayStats&) displayStats).samples;
+}
+
+static double samplesPerSecond( int batch, int samples, uint32_t& frames ) {
+  // the lines go round a short list, the values do not matter
+  std::vector<std::string> lines;
+  for (int l=0; l<16; l++) {
+    std::string line = "sensor::";
+    for (int i=0; i<batch; i++)
+      line += std::to_string( (l * 7 + i * 3) % 50 ) + (i + 1 < batch ? "," : "\n");
+    lines.push_back( line );
+  }
+  uint32_t before = appliedSamples(), framesBefore = displayStats.frames;
+  double start = hostSeconds();
+  for (int sent=0, l=0; sent<samples; l = (l + 1) % 16) {
+    while ( !pushData( INGEST_SERIAL, lines[l].data(), lines[l].size() ) )
+      std::this_thread::yield();
+    sent += batch;
+  }
+  while ( appliedSamples() - before < (uint32_t) samples && hostSeconds() - start < 30 )
+    std::this_thread::yield();
+  double seconds = hostSeconds() - start;
+  CHECK_EQ( appliedSamples() - before, samples );
+  frames = displayStats.frames - framesBefore;
+  return samples / seconds;
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  xTaskCreate( &taskFunction, "DisplayTask", 4096, NULL, 5, NULL );
+  vTaskDelay( 50 );
+
+  uint32_t dropsBefore = ingestRings[INGEST_SERIAL].stats().overflows;
+  int batches[] = { 1, 4, 16, 64 };
+  for (int batch : batches) {
+    uint32_t frames;
+    double rate = samplesPerSecond( batch, 128000, frames );
+    printf( "%2d values per line: %8.0f samples/s, %u frames\n", batch, rate, frames );
+  }
+  printf( "%u pushes found the ring full and were retried\n",
+          ingestRings[INGEST_SERIAL].stats().overflows - dropsBefore );
+  CHECK_EQ( parseStats.badValues, 0 );
+  hostExit( hostResult() );
+}
@@ -0,0 +1,150 @@
+// Binary telemetry: what the Encoder sends comes back out of the
+// StreamFramer and BinaryDecoder sample for sample, extremes included,
+// and broken frames are counted rather than misread.  Then the same
+// samples as "name::value" lines, bytes and decode time per sample for
+// each.
+
+#include "HostTest.hpp"
+#include "BinaryDecoder.hpp"
+#include "StreamFramer.hpp"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace DisplayTask;
+
+static const char* names[] = { "temperature", "pressure", "accel/x", "battery" };
+static const int   numSeries = 4;
+
+struct Sample {
+  int     series;
+  int32_t value;
+  bool operator== ( const Sample& s ) const { return series == s.series && value == s.value; }
+};
+
+static void append( void* context, const uint8_t* frame, int len ) {
+  ((std::string*) context)->append( (const char*) frame, len );
+}
+
+// all frames in the stream through a framer and decoder
+static std::vector<Sample> decode( const std::string& stream, BinaryDecoder& decoder ) {
+  std::vector<Sample> out;
+  StreamFramer framer;
+  framer.feed( stream.data(), stream.size() );
+  StrView record;
+  while ( framer.next( record ) ) {
+    if ( !BinaryDecoder::isFrame( record ) )
+      continue;
+    decoder.begin( record );
+    Sample s;
+    while ( decoder.next( s.series, s.value ) )
+      out.push_back( s );
+  }
+  return out;
+}
+
+int main( void ) {
+  srand( 17 );
+  std::vector<Sample> samples;
+  int32_t value[ numSeries ] = {};
+  for (int i=0; i<200000; i++) {
+    Sample s;
+    s.series = rand() % 8 == 0 ? rand() % numSeries : i % numSeries;
+    // mostly a slow walk, now and then a jump, rarely the extremes
+    int r = rand() % 1000;
+    value[ s.series ] += r < 900 ? rand() % 21 - 10 : rand() % 20001 - 10000;
+    s.value = r == 0 ? INT32_MAX : r == 1 ? INT32_MIN : value[ s.series ];
+    samples.push_back( s );
+  }
+
+  std::string binary;
+  BinaryProtocol::Encoder encoder( append, &binary );
+  for (int id=0; id<numSeries; id++)
+    CHECK( encoder.registerSeries( id, names[id] ) );
+  for (const Sample& s : samples)
+    encoder.add( s.series, s.value );
+  encoder.flush();
+
+  BinaryDecoder decoder;
+  std::vector<Sample> decoded = decode( binary, decoder );
+  CHECK( decoded == samples );
+  CHECK_EQ( decoder.stats().badFrames, 0 );
+  CHECK_EQ( decoder.stats().registrations, numSeries );
+  for (int id=0; id<numSeries; id++)
+    CHECK( StrView( decoder.series( id ).name, decoder.series( id ).nameLen ) == StrView( names[id] ) );
+
+  // a frame shorter than its header says, a type nobody knows, samples
+  // for a series never registered
+  const std::string broken[] = {
+    std::string( "\xA5\x02\x05\x00\x01", 5 ),
+    std::string( "\xA5\x07\x01\x00", 4 ),
+    std::string( "\xA5\x02\x03\x09\x01\x02", 6 ),
+  };
+  BinaryDecoder brokenDecoder;
+  for (const std::string& frame : broken) {
+    brokenDecoder.begin( StrView( frame ) );
+    int series, v;
+    while ( brokenDecoder.next( series, v ) )
+      ;
+  }
+  CHECK_EQ( brokenDecoder.stats().badFrames, 2 );
+  CHECK_EQ( brokenDecoder.stats().unknownSeries, 1 );
+  CHECK_EQ( brokenDecoder.stats().samples, 0 );
+
+  // the same samples as text lines, values the text path can hold
+  std::string text;
+  std::vector<Sample> textSamples;
+  for (const Sample& s : samples) {
+    if ( s.value == INT32_MAX || s.value == INT32_MIN )
+      continue;
+    text += std::string( names[ s.series ] ) + "::" + std::to_string( s.value ) + "\n";
+    textSamples.push_back( s );
+  }
+  std::string binaryText;
+  BinaryProtocol::Encoder textEncoder( append, &binaryText );
+  for (int id=0; id<numSeries; id++)
+    textEncoder.registerSeries( id, names[id] );
+  for (const Sample& s : textSamples)
+    textEncoder.add( s.series, s.value );
+  textEncoder.flush();
+
+  const int passes = 20;
+  long sum = 0;
+  double start = hostSeconds();
+  for (int pass=0; pass<passes; pass++) {
+    BinaryDecoder d;
+    StreamFramer framer;
+    framer.feed( binaryText.data(), binaryText.size() );
+    StrView record;
+    int series, v;
+    while ( framer.next( record ) ) {
+      d.begin( record );
+      while ( d.next( series, v ) )
+        sum += series + v;
+    }
+  }
+  double binarySeconds = (hostSeconds() - start) / passes;
+
+  ParseStats stats = {};
+  start = hostSeconds();
+  for (int pass=0; pass<passes; pass++) {
+    StreamFramer framer;
+    framer.feed( text.data(), text.size() );
+    StrView record;
+    while ( framer.next( record ) ) {
+      LineParser parser( record.data, record.len, stats );
+      Line line;
+      while ( parser.next( line ) )
+        sum += line.name.len + line.value;
+    }
+  }
+  double textSeconds = (hostSeconds() - start) / passes;
+  hostKeep( sum );
+  CHECK_EQ( stats.dataLines, passes * textSamples.size() );
+
+  double n = textSamples.size();
+  printf( "binary: %.2f bytes and %.1f ns per sample\n", binaryText.size() / n, binarySeconds / n * 1e9 );
+  printf( "text:   %.2f bytes and %.1f ns per sample\n", text.size() / n, textSeconds / n * 1e9 );
+  CHECK( binaryText.size() < text.size() );
+  return hostResult();
+}
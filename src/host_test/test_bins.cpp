@@ -0,0 +1,69 @@
+// Aggregation bins: one series at 1, 10 and 100 kHz of simulated time, with
+// updateRates() called every millisecond as the display task would.  Every
+// sample must end up in a committed point or the open bin, the points per
+// second must settle at or below PLOT_POINT_RATE whatever the input rate,
+// and a single spike must survive in the history's min/max.
+
+#include "HostTest.hpp"
+#include "DisplayTask.hpp"
+#include <stdlib.h>
+
+using namespace DisplayTask;
+
+static const int seconds = 4;
+
+static void load( int rate ) {
+  GraphDisplay graph( 0, DISPLAY_WIDTH, 0, 200 );
+  std::string name = "r" + std::to_string( rate );
+  int id = graph.plotId( StrView( name.c_str() ) );
+  if ( !CHECK( id >= 0 ) )
+    return;
+  const GraphDisplay::Plot& plot = graph.plot( id );
+
+  const int spike = wholeToSample( 100000 );
+  uint64_t samples = 0, aggregated = 0, points = 0, lastSecondPoints = 0;
+  double busy = 0;
+  uint32_t nowUs = 0;
+  for (int ms=0; ms<seconds * 1000; ms++) {
+    nowUs = ms * 1000;
+    graph.updateRates( nowUs );
+    int due = (int) ((uint64_t) (ms + 1) * rate / 1000 - samples);
+    double start = hostSeconds();
+    for (int i=0; i<due; i++, samples++) {
+      int v = samples == (uint64_t) rate * (seconds - 1) ? spike : wholeToSample( rand() % 100 );
+      uint32_t inBin = plot.bin.count;
+      if ( graph.addData( id, v ) ) {
+        aggregated += inBin + 1;
+        points++;
+        lastSecondPoints += ms >= (seconds - 1) * 1000;
+      }
+    }
+    busy += hostSeconds() - start;
+  }
+  uint64_t dropped = samples - aggregated - plot.bin.count;
+  CHECK_EQ( dropped, 0 );
+  CHECK( lastSecondPoints <= PLOT_POINT_RATE );
+  CHECK( lastSecondPoints > 0 );
+  // the spike went into the last second's points
+  GraphDisplay::Range r = plot.query( plot.seq - lastSecondPoints, lastSecondPoints );
+  CHECK_EQ( r.max, spike );
+  // and in the point holding it when asked one point at a time, as
+  // narrow columns do
+  int holding = 0;
+  for (uint32_t s=plot.seq - lastSecondPoints; s<plot.seq; s++)
+    holding += plot.query( s, 1 ).max == spike;
+  CHECK( holding >= 1 && holding <= 2 );
+  printf( "%6d Hz: %7llu samples, %5llu points (%llu in the last second, %d samples each), "
+          "%llu dropped, %.0f ns per sample\n",
+          rate, (unsigned long long) samples, (unsigned long long) points,
+          (unsigned long long) lastSecondPoints, plot.binWidth, (unsigned long long) dropped,
+          busy / samples * 1e9 );
+}
+
+int main( void ) {
+  srand( 20 );
+  const int rates[] = { 1000, 10000, 100000 };
+  for (int rate : rates)
+    load( rate );
+  return hostResult();
+}
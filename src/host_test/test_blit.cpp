@@ -0,0 +1,94 @@
+// blit_vram(): the bytes it puts on the wire, commands and data, against
+// a reference renderer that windows each clipped rect and sends its
+// pixels row by row.  Covers odd widths, rects running off the screen or
+// lying outside it, and several rects per call.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include <stdlib.h>
+#include <vector>
+
+using MockPanel::WireByte;
+
+static void command( std::vector<WireByte>& wire, uint8_t cmd, int a, int b ) {
+  wire.push_back( { 0, cmd } );
+  wire.push_back( { 1, (uint8_t) (a >> 8) } );
+  wire.push_back( { 1, (uint8_t) a } );
+  wire.push_back( { 1, (uint8_t) (b >> 8) } );
+  wire.push_back( { 1, (uint8_t) b } );
+}
+
+static void reference( std::vector<WireByte>& wire, const rect_s& r ) {
+  int xe = r.x + r.width, ye = r.y + r.height;
+  if ( xe > DISPLAY_WIDTH )
+    xe = DISPLAY_WIDTH;
+  if ( ye > DISPLAY_HEIGHT )
+    ye = DISPLAY_HEIGHT;
+  if ( r.x >= xe || r.y >= ye )
+    return;
+  command( wire, ILI9341_CASET, r.x, xe - 1 );
+  command( wire, ILI9341_PASET, r.y, ye - 1 );
+  wire.push_back( { 0, ILI9341_RAMWR } );
+  for (int y=r.y; y<ye; y++)
+    for (int x=r.x; x<xe; x++) {
+      uint16_t c = MockPanel::vramColor( x, y );
+      wire.push_back( { 1, (uint8_t) (c >> 8) } );
+      wire.push_back( { 1, (uint8_t) c } );
+    }
+}
+
+static rect_s randomRect( void ) {
+  rect_s r;
+  r.x = rand() % (DISPLAY_WIDTH + 10);
+  r.y = rand() % (DISPLAY_HEIGHT + 10);
+  r.width = rand() % 4 == 0 ? rand() % 4 : 1 + rand() % 120;
+  r.height = 1 + rand() % 120;
+  return r;
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+  srand( 5 );
+  for (int i=0; i<DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+    vram[i] = rand();
+  display_vram();
+
+  std::vector<WireByte> expected;
+  int badCalls = 0;
+  uint64_t traced = 0;
+  for (int call=0; call<500; call++) {
+    rect_s rects[ 6 ];
+    int count = 1 + rand() % 6;
+    for (int i=0; i<count; i++)
+      rects[i] = randomRect();
+    // the first rect always has an odd width, every fifth call it straddles the right edge
+    rects[0].width |= 1;
+    if ( call % 5 == 0 )
+      rects[0].x = DISPLAY_WIDTH - rects[0].width / 2;
+
+    expected.clear();
+    for (int i=0; i<count; i++)
+      reference( expected, rects[i] );
+    MockPanel::clearTrace();
+    MockPanel::record( true );
+    if ( count == 1 )
+      blit_vram( rects[0].x, rects[0].y, rects[0].width, rects[0].height );
+    else
+      blit_vram( rects, count );
+    MockPanel::record( false );
+    traced += MockPanel::trace().size();
+    if ( !(MockPanel::trace() == expected) ) {
+      if ( badCalls == 0 )
+        printf( "call %d: %zu bytes on the wire, %zu expected\n",
+                call, MockPanel::trace().size(), expected.size() );
+      badCalls++;
+    }
+  }
+  CHECK_EQ( badCalls, 0 );
+  CHECK_EQ( MockPanel::stats().outOfWindow, 0 );
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+  printf( "500 blit calls, %llu bytes on the wire compared\n", (unsigned long long) traced );
+  return hostResult();
+}
@@ -0,0 +1,81 @@
+// A burst of datagrams through the pool as the receive task hands them
+// over, with the display task running on its own: 50 datagrams are
+// submitted back to back from one sender, built with a pool big enough
+// that the whole burst waits at once.  Every sample in them must be
+// applied and flushed within a few frames; the latency from submit to
+// flush and the deepest the pool got are printed.  A datagram tagged with
+// a slot outside the source table is dropped and counted, and does not
+// end up in the middle of another sender's line.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "DisplayTask.hpp"
+#include <string>
+#include <thread>
+#include <string.h>
+
+using namespace DisplayTask;
+
+static const int burst     = 50;
+static const int lines     = 10;  // per datagram
+static const int maxFrames = 3;   // to apply and flush the burst
+
+static volatile DisplayStats& stats( void ) {
+  return (volatile DisplayStats&) displayStats;
+}
+
+static void send( uint32_t tag, const std::string& text ) {
+  char* buffer;
+  while ( (buffer = acquireDatagram()) == nullptr )
+    std::this_thread::yield();
+  memcpy( buffer, text.data(), text.size() );
+  submitDatagram( (int) text.size(), tag );
+}
+
+// until the display task has applied expected samples, or stops applying
+static void settle( uint32_t expected ) {
+  double start = hostSeconds();
+  while ( stats().samples < expected && hostSeconds() - start < 2 )
+    std::this_thread::yield();
+  CHECK_EQ( stats().samples, expected );
+  // and drawn the frame they went into
+  vTaskDelay( 3 * 1000 / MAX_FRAME_RATE );
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  xTaskCreate( &taskFunction, "DisplayTask", 4096, NULL, 5, NULL );
+  vTaskDelay( 50 );
+
+  uint32_t tag = senderTag( 0, 1 );
+  uint32_t frames = stats().frames, samples = stats().samples;
+  for (int i=0; i<burst; i++) {
+    std::string d;
+    for (int l=0; l<lines; l++)
+      d += (l % 2 ? "b::" : "a::") + std::to_string( (i + l) % 100 ) + "\n";
+    send( tag, d );
+  }
+  settle( samples + burst * lines );
+  uint32_t burstFrames = stats().frames - frames;
+  CHECK( burstFrames >= 1 && burstFrames <= (uint32_t) maxFrames );
+  CHECK_EQ( stats().messages, burst );
+  CHECK_EQ( stats().latencyMessages, burst );
+  printf( "%d datagrams in %u frames: latency max %u us, mean %u us, "
+          "pool peak %u buffers, backlog peak %u bytes, %u budget hits\n",
+          burst, burstFrames, stats().latencyMaxUs, stats().latencyMeanUs,
+          datagramPool.stats().highWater, stats().maxBacklog, stats().budgetHits );
+
+  // half a line, a datagram of no known sender, then the rest of the line
+  samples = stats().samples;
+  send( tag, "x::1" );
+  send( senderTag( UDP_MAX_SOURCES, 1 ), "23\n" );
+  send( tag, "4\n" );
+  settle( samples + 1 );
+  CHECK_EQ( stats().badTags, 1 );
+  int id = graphDisplay.plotId( StrView( "1/x" ), false );
+  if ( CHECK( id >= 0 ) ) {
+    const GraphDisplay::Plot& plot = graphDisplay.plot( id );
+    CHECK_EQ( plot.at( plot.seq - 1 ), wholeToSample( 14 ) );
+  }
+  hostExit( hostResult() );
+}
@@ -0,0 +1,122 @@
+// Damage tracking: after random drawing, the damaged regions cover every
+// vram pixel that changed, and once flush_vram() has sent them the mock
+// panel shows exactly what vram holds.  Built for each vram layout, with
+// and without tile hashing.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "VramLayout.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t before[ DISPLAY_WIDTH * DISPLAY_HEIGHT ];
+
+static int randomIn( int lo, int hi ) {
+  return lo + rand() % (hi - lo + 1);
+}
+
+static point_s randomPoint( void ) {
+  // reaching a little past the edges, for the clipping
+  return { (uint16_t) randomIn( 0, DISPLAY_WIDTH + 20 ), (uint16_t) randomIn( 0, DISPLAY_HEIGHT + 20 ) };
+}
+
+static void drawSomething( void ) {
+  char text[] = "damage 0123456789";
+  uint8_t color = rand();
+  switch ( rand() % 8 ) {
+    case 0:
+      draw_line( randomPoint(), randomPoint(), color );
+      break;
+    case 1:
+      draw_rectangle( randomPoint(), randomIn( 1, 80 ), randomIn( 1, 80 ), color, rand() );
+      break;
+    case 2:
+      draw_circle( randomPoint(), randomIn( 0, 40 ), color, rand() );
+      break;
+    case 3:
+      Draw_8x12_string( text, randomIn( 1, sizeof(text) - 1 ), randomIn( -10, DISPLAY_WIDTH ), randomIn( -10, DISPLAY_HEIGHT ), color );
+      break;
+    case 4:
+      Draw_5x8_string( text, randomIn( 1, sizeof(text) - 1 ), randomIn( -10, DISPLAY_WIDTH ), randomIn( -10, DISPLAY_HEIGHT ), color );
+      break;
+    case 5:
+      clear_vram( randomIn( 0, DISPLAY_WIDTH ), randomIn( 0, DISPLAY_HEIGHT ), randomIn( 0, 100 ), randomIn( 0, 100 ) );
+      break;
+    case 6:
+      shift_vram_left( randomIn( 0, DISPLAY_WIDTH - 2 ), randomIn( 0, DISPLAY_HEIGHT - 1 ),
+                       randomIn( 2, DISPLAY_WIDTH ), randomIn( 1, 100 ), randomIn( 1, 20 ) );
+      break;
+    default: {
+      // the same pixels drawn again, which tile hashing should not resend
+      point_s pos = { 120, 160 };
+      draw_rectangle( pos, 40, 40, 7, 7 );
+      break;
+    }
+  }
+}
+
+// every pixel that differs from before lies in a damaged region
+static int uncovered( void ) {
+  const rect_s* rects;
+  int numRects = get_dirty_rects( &rects );
+  int missed = 0;
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      uint32_t i = vram_layout::index( x, y );
+      if ( vram[i] == before[i] )
+        continue;
+      bool covered = false;
+      for (int r=0; r<numRects && !covered; r++)
+        covered = x >= rects[r].x && x < rects[r].x + rects[r].width &&
+                  y >= rects[r].y && y < rects[r].y + rects[r].height;
+      if ( !covered )
+        missed++;
+    }
+  }
+  return missed;
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+  srand( 1 );
+  for (int i=0; i<DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+    vram[i] = rand();
+  display_vram();
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+
+  const int rounds = 3000;
+  int badRounds = 0, missedRounds = 0;
+  uint64_t pixelsSent = 0;
+  for (int round=0; round<rounds; round++) {
+    memcpy( before, vram, sizeof(before) );
+    int n = randomIn( 1, 4 );
+    for (int i=0; i<n; i++)
+      drawSomething();
+    if ( uncovered() > 0 )
+      missedRounds++;
+    MockPanel::resetStats();
+    flush_vram();
+    pixelsSent += MockPanel::stats().pixels;
+    if ( MockPanel::mismatches() > 0 ) {
+      if ( badRounds == 0 )
+        printf( "round %d: %d pixels differ from vram\n", round, MockPanel::mismatches() );
+      badRounds++;
+    }
+  }
+  CHECK_EQ( missedRounds, 0 );
+  CHECK_EQ( badRounds, 0 );
+
+  // a single character costs a window of its own, not a frame
+  MockPanel::resetStats();
+  Draw_8x12_string( (char*) "x", 1, 100, 100, 0xFF );
+  flush_vram();
+  CHECK( MockPanel::stats().pixels <= 16 * 16 * 4 );
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+
+  printf( "layout %d, tile hash %d: %d rounds, %.0f pixels sent per flush against %d for a full frame\n",
+          CONFIG_VRAM_LAYOUT, CONFIG_VRAM_TILE_HASH, rounds,
+          (double) pixelsSent / rounds, DISPLAY_WIDTH * DISPLAY_HEIGHT );
+  return hostResult();
+}
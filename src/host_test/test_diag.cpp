@@ -0,0 +1,103 @@
+// Diagnostics log: a call site logs once per DIAG_LOG_INTERVAL_MS and is
+// counted after that, a full ring drops and counts, and drained records
+// come out as lines no longer than DIAG_LINE_LEN.  Then what a log call
+// costs the task making it, against formatting the same record with
+// snprintf and printing it with fprintf as the data path used to.
+
+#include "HostTest.hpp"
+#include "Diagnostics.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+
+using namespace Diagnostics;
+
+// what drainLog() printed
+static std::string drained( void ) {
+  fflush( stdout );
+  FILE* capture = tmpfile();
+  int saved = dup( fileno( stdout ) );
+  dup2( fileno( capture ), fileno( stdout ) );
+  drainLog();
+  fflush( stdout );
+  dup2( saved, fileno( stdout ) );
+  close( saved );
+  std::string out;
+  char buf[ 512 ];
+  rewind( capture );
+  size_t n;
+  while ( (n = fread( buf, 1, sizeof(buf), capture )) > 0 )
+    out.append( buf, n );
+  fclose( capture );
+  return out;
+}
+
+static int lines( const std::string& s, size_t& longest ) {
+  int count = 0;
+  longest = 0;
+  for (size_t start=0, end; (end = s.find( '\n', start )) != std::string::npos; start = end + 1) {
+    count++;
+    longest = std::max( longest, end - start + 1 );
+  }
+  return count;
+}
+
+static void checkLog( void ) {
+  size_t longest;
+  // one site: the first call is kept, the rest within the interval counted
+  for (int i=0; i<100; i++)
+    log( WARN, "test", "ring full %d", i );
+  CHECK_EQ( logStats.records, 1 );
+  CHECK_EQ( logStats.suppressed, 99 );
+  CHECK_EQ( lines( drained(), longest ), 1 );
+
+  // a long tag and arguments are cut at the line length
+  log( INFO, "a tag far longer than anything the components use, to run past the line",
+       "%d %d %d %d %d and then some more words", INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN, INT32_MIN );
+  std::string out = drained();
+  CHECK_EQ( lines( out, longest ), 1 );
+  CHECK( longest <= DIAG_LINE_LEN );
+
+  // more sites than the ring holds: the overflow is dropped, not blocked on
+  static char formats[ DIAG_LOG_LEN + 8 ][ 16 ];
+  uint32_t droppedBefore = logStats.dropped;
+  for (int i=0; i<DIAG_LOG_LEN + 8; i++) {
+    snprintf( formats[i], sizeof(formats[i]), "site %d", i );
+    log( INFO, "test", formats[i] );
+  }
+  CHECK_EQ( logStats.dropped - droppedBefore, 8 );
+  CHECK_EQ( lines( drained(), longest ), DIAG_LOG_LEN );
+}
+
+int main( void ) {
+  checkLog();
+
+  // the hot path: a site over its rate limit, as a flood of events is
+  const int calls = 2000000;
+  double start = hostSeconds();
+  for (int i=0; i<calls; i++)
+    log( WARN, "uart_events", "ring buffer full, %d bytes", i );
+  double logSeconds = hostSeconds() - start;
+
+  char line[ DIAG_LINE_LEN ];
+  long sum = 0;
+  start = hostSeconds();
+  for (int i=0; i<calls; i++)
+    sum += snprintf( line, sizeof(line), "W (%u) %s: ring buffer full, %d bytes\n", 1234u, "uart_events", i );
+  double formatSeconds = hostSeconds() - start;
+  hostKeep( sum );
+
+  FILE* null = fopen( "/dev/null", "w" );
+  start = hostSeconds();
+  for (int i=0; i<calls / 10; i++)
+    fprintf( null, "W (%u) %s: ring buffer full, %d bytes\n", 1234u, "uart_events", i );
+  fflush( null );
+  double printSeconds = (hostSeconds() - start) * 10;
+  fclose( null );
+
+  printf( "log %.1f ns per call, snprintf %.1f ns, fprintf %.1f ns, before any bytes go out on the uart\n",
+          logSeconds / calls * 1e9, formatSeconds / calls * 1e9, printSeconds / calls * 1e9 );
+  CHECK( logSeconds < formatSeconds );
+  return hostResult();
+}
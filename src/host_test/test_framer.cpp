@@ -0,0 +1,104 @@
+// StreamFramer: a stream of text lines, overlong lines and binary frames
+// (whose payloads hold '\n' and BINARY_MAGIC bytes) is cut into records.
+// Fed at random chunk boundaries, down to a byte at a time, it must give
+// exactly the records it gives for the stream in one piece, with both
+// overflow policies.
+
+#include "HostTest.hpp"
+#include "StreamFramer.hpp"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace DisplayTask;
+
+static std::string makeStream( void ) {
+  std::string s;
+  for (int i=0; i<3000; i++) {
+    int kind = rand() % 10;
+    if ( kind < 6 ) {
+      int len = rand() % 60;
+      for (int j=0; j<len; j++)
+        s += "abc:: 0123456789,;+"[ rand() % 19 ];
+      s += rand() % 4 == 0 ? "\r\n" : "\n";
+    }
+    else if ( kind < 7 ) {
+      // longer than the framer keeps
+      int len = StreamFramer::maxLine + rand() % 600;
+      for (int j=0; j<len; j++)
+        s += (char) ('a' + rand() % 26);
+      s += "\n";
+    }
+    else {
+      int len = rand() % 256;
+      s += (char) BINARY_MAGIC;
+      s += (char) (1 + rand() % 2);
+      s += (char) len;
+      for (int j=0; j<len; j++)
+        s += rand() % 8 == 0 ? '\n' : rand() % 8 == 0 ? (char) BINARY_MAGIC : (char) rand();
+    }
+  }
+  return s;
+}
+
+// every record, with a mark for those cut short
+static std::vector<std::string> frame( const std::string& stream, StreamFramer::Overflow policy,
+                                       bool randomChunks, FramerStats& stats ) {
+  StreamFramer framer( policy );
+  std::vector<std::string> records;
+  size_t pos = 0;
+  while ( pos < stream.size() ) {
+    size_t len = stream.size() - pos;
+    if ( randomChunks )
+      len = std::min( len, (size_t) (rand() % 4 == 0 ? 1 : 1 + rand() % 700) );
+    // the framer may keep pointing into a chunk until it is used up
+    std::string chunk = stream.substr( pos, len );
+    framer.feed( chunk.data(), chunk.size() );
+    StrView r;
+    while ( framer.next( r ) )
+      records.push_back( (framer.cut() ? "[cut]" : "") + std::string( r.data, r.len ) );
+    pos += len;
+  }
+  StrView r;
+  if ( framer.flush( r ) )
+    records.push_back( "[flushed]" + std::string( r.data, r.len ) );
+  stats = framer.stats();
+  return records;
+}
+
+int main( void ) {
+  srand( 16 );
+  std::string stream = makeStream();
+  // and one line the sender never ended
+  stream += "last words";
+
+  StreamFramer::Overflow policies[] = { StreamFramer::TRUNCATE, StreamFramer::SPLIT };
+  for (StreamFramer::Overflow policy : policies) {
+    FramerStats whole, stats;
+    std::vector<std::string> expected = frame( stream, policy, false, whole );
+    CHECK( whole.frames > 0 && whole.overlong > 0 );
+    CHECK( expected.back() == "[flushed]last words" );
+    int differ = 0;
+    for (int run=0; run<200; run++) {
+      std::vector<std::string> records = frame( stream, policy, true, stats );
+      if ( records != expected || stats.records != whole.records ||
+           stats.frames != whole.frames || stats.overlong != whole.overlong )
+        differ++;
+    }
+    CHECK_EQ( differ, 0 );
+    printf( "%s: %u records, %u binary frames, %u overlong, compared over 200 random chunkings\n",
+            policy == StreamFramer::TRUNCATE ? "truncate" : "split",
+            whole.records, whole.frames, whole.overlong );
+  }
+
+  // every frame comes out whole and nothing else starts with the magic
+  FramerStats stats;
+  std::vector<std::string> records = frame( stream, StreamFramer::TRUNCATE, true, stats );
+  int badFrames = 0;
+  for (const std::string& r : records)
+    if ( !r.empty() && (uint8_t) r[0] == BINARY_MAGIC &&
+         (r.size() < 3 || r.size() != 3 + (size_t) (uint8_t) r[2]) )
+      badFrames++;
+  CHECK_EQ( badFrames, 0 );
+  return hostResult();
+}
@@ -0,0 +1,130 @@
+// Vram layouts: every VramLayout<> specialization is checked against plain
+// per-pixel addressing, then the layout this binary is built with
+// (CONFIG_VRAM_LAYOUT) is timed for full scanout, text and graph drawing.
+// Built once per layout, so the three runs print comparable numbers.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "VramLayout.hpp"
+#include "DisplayTask.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace DisplayTask;
+
+static const int pixels = DISPLAY_WIDTH * DISPLAY_HEIGHT;
+
+// what the layout's span operations must do, a pixel at a time
+template <int Layout>
+static int checkLayout( void ) {
+  typedef VramLayout<Layout> L;
+  static uint8_t fb[ pixels ], image[ DISPLAY_HEIGHT ][ DISPLAY_WIDTH ];
+  static bool used[ pixels ];
+  int bad = 0;
+
+  memset( used, 0, sizeof(used) );
+  for (int y=0; y<DISPLAY_HEIGHT; y++)
+    for (int x=0; x<DISPLAY_WIDTH; x++) {
+      uint32_t i = L::index( x, y );
+      if ( i >= (uint32_t) pixels || used[i] )
+        bad++;
+      else
+        used[i] = true;
+    }
+
+  for (int y=0; y<DISPLAY_HEIGHT; y++)
+    for (int x=0; x<DISPLAY_WIDTH; x++)
+      fb[ L::index( x, y ) ] = image[y][x] = rand();
+
+  for (int round=0; round<2000; round++) {
+    int x = rand() % DISPLAY_WIDTH, y = rand() % DISPLAY_HEIGHT;
+    int w = 1 + rand() % (DISPLAY_WIDTH - x), h = 1 + rand() % (DISPLAY_HEIGHT - y);
+    uint8_t c = rand();
+    switch ( rand() % 3 ) {
+      case 0:
+        L::fill_span( fb, x, y, w, c );
+        for (int i=x; i<x+w; i++)
+          image[y][i] = c;
+        break;
+      case 1:
+        L::fill_rect( fb, x, y, w, h, c );
+        for (int j=y; j<y+h; j++)
+          memset( &image[j][x], c, w );
+        break;
+      default: {
+        if ( w < 2 )
+          break;
+        int dx = 1 + rand() % (w - 1);
+        L::shift_left( fb, x, y, w, h, dx );
+        for (int j=y; j<y+h; j++)
+          memmove( &image[j][x], &image[j][x + dx], w - dx );
+        break;
+      }
+    }
+    uint16_t out[ DISPLAY_WIDTH ];
+    L::convert_span( fb, x, y, w, myPalette, out );
+    for (int i=0; i<w; i++)
+      if ( out[i] != vram_swap16( myPalette[ image[y][x + i] ] ) )
+        bad++;
+  }
+
+  for (int y=0; y<DISPLAY_HEIGHT; y++)
+    for (int x=0; x<DISPLAY_WIDTH; x++)
+      if ( fb[ L::index( x, y ) ] != image[y][x] )
+        bad++;
+  return bad;
+}
+
+static void dropPixels( const uint32_t*, const int ) {}
+
+template <typename F>
+static double secondsPer( int runs, F work ) {
+  work();
+  double start = hostSeconds();
+  for (int i=0; i<runs; i++)
+    work();
+  return (hostSeconds() - start) / runs;
+}
+
+int main( void ) {
+  srand( 4 );
+  CHECK_EQ( checkLayout<VRAM_LAYOUT_COLUMN_MAJOR>(), 0 );
+  CHECK_EQ( checkLayout<VRAM_LAYOUT_ROW_MAJOR>(), 0 );
+  CHECK_EQ( checkLayout<VRAM_LAYOUT_TILED_8X8>(), 0 );
+
+  // the scanout only converts, the pixels go nowhere
+  lcd_bus_s nullBus = MockPanel::bus;
+  nullBus.write_pixels = dropPixels;
+  lcd_set_bus( &nullBus );
+  ili9341_init();
+  for (int i=0; i<pixels; i++)
+    vram[i] = rand();
+  double scanout = secondsPer( 200, [] { display_vram(); } );
+
+  char line[] = "0123456789 abcdefghijklmnopqrstuvwxyz";
+  double text = secondsPer( 200, [&] {
+      for (int y=0; y<DISPLAY_HEIGHT; y+=12)
+        Draw_8x12_string( line, DISPLAY_WIDTH / 8, 0, y, y );
+      for (int y=0; y<DISPLAY_HEIGHT; y+=8)
+        Draw_5x8_string( line, DISPLAY_WIDTH / 6, 0, y, y + 1 );
+    } );
+
+  int ids[3] = { graphDisplay.plotId( "a" ), graphDisplay.plotId( "b" ), graphDisplay.plotId( "c" ) };
+  int sample = 0;
+  double graph = secondsPer( 2000, [&] {
+      sample++;
+      for (int p=0; p<3; p++)
+        graphDisplay.addData( ids[p], wholeToSample( (sample * (p + 3)) % 97 - 40 ) );
+      graphDisplay.drawPlots();
+    } );
+
+  // what was drawn reaches the panel unchanged
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  display_vram();
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+
+  printf( "layout %d: scanout %.1f us, text screen %.1f us, graph frame (3 plots) %.2f us\n",
+          CONFIG_VRAM_LAYOUT, scanout * 1e6, text * 1e6, graph * 1e6 );
+  return hostResult();
+}
@@ -0,0 +1,132 @@
+// Serial replay: text lines, "+++" commands and binary frames are written
+// into the pty as fast as the serial task takes them, while this thread
+// plays the display task and drains the serial ring and the command lane.
+// Taken in order, what comes out of the two must be the records of the
+// stream: each lifted command one whole "+++" line that was sent as a
+// record, and every frame intact, including one whose payload holds
+// "\n+++".  Built a second time with a pattern queue too short to hold
+// every line end, so reads also span lines whose ends were missed.
+
+#include "HostTest.hpp"
+#include "SerialTask.hpp"
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unistd.h>
+#include <algorithm>
+
+using namespace DisplayTask;
+
+static void append( void* context, const uint8_t* frame, int len ) {
+  ((std::string*) context)->append( (const char*) frame, len );
+}
+
+static std::vector<std::string> records( StreamFramer& framer, const char* data, int len ) {
+  std::vector<std::string> out;
+  framer.feed( data, len );
+  StrView r;
+  while ( framer.next( r ) )
+    out.push_back( std::string( r.data, r.len ) );
+  return out;
+}
+
+int main( void ) {
+  xTaskCreate( &SerialTask::taskFunction, "SerialTask", 3072, NULL, 5, NULL );
+  int sender = hostUartSender();
+  srand( 22 );
+
+  // registering a series and sending 5, -17, -39, -61 gives the deltas
+  // 5 and -22 three times, zigzag encoded as 0x0A 0x2B 0x2B 0x2B
+  std::string tricky;
+  BinaryProtocol::Encoder encoder( append, &tricky );
+  encoder.registerSeries( 0, "x" );
+  const int values[] = { 5, -17, -39, -61 };
+  for (int v : values)
+    encoder.add( 0, v );
+  encoder.flush();
+  CHECK( tricky.find( "\n+++" ) != std::string::npos );
+
+  std::string stream;
+  int commands = 0;
+  for (int i=0; i<20000; i++) {
+    int kind = rand() % 20;
+    if ( kind < 12 )
+      stream += "t" + std::to_string( i % 7 ) + "::" + std::to_string( rand() % 1000 ) + "\n";
+    else if ( kind < 15 ) {
+      // numbered, so each lifted command matches one record only
+      stream += "+++SPAN PLOTS:" + std::to_string( i ) + "\n";
+      commands++;
+    }
+    else if ( kind < 18 )
+      stream += tricky;
+    else if ( kind < 19 )
+      stream += "not a command +++STATS\n";
+    else {
+      int len = rand() % 64;
+      stream += std::string( "\xA5\x02", 2 ) + (char) len;
+      for (int j=0; j<len; j++)
+        stream += "\n+++ab"[ rand() % 6 ];
+    }
+  }
+  StreamFramer whole;
+  std::vector<std::string> expected = records( whole, stream.data(), stream.size() );
+
+  std::thread writer( [sender, &stream] {
+      for (size_t done=0; done<stream.size(); ) {
+        ssize_t n = write( sender, stream.data() + done, std::min( (size_t) 4096, stream.size() - done ) );
+        if ( n <= 0 )
+          break;
+        done += n;
+      }
+    } );
+
+  StreamFramer framer;
+  std::vector<std::string> data, lifted;
+  size_t bytes = 0;
+  double last = hostSeconds();
+  while ( bytes < stream.size() && hostSeconds() - last < 2 ) {
+    StrView m;
+    bool any = false;
+    if ( ingestRings[INGEST_SERIAL].peek( m ) ) {
+      std::vector<std::string> r = records( framer, m.data, m.len );
+      data.insert( data.end(), r.begin(), r.end() );
+      bytes += m.len;
+      ingestRings[INGEST_SERIAL].release();
+      any = true;
+    }
+    if ( ingestRings[INGEST_COMMAND].peek( m ) ) {
+      lifted.push_back( std::string( m.data, m.len ) );
+      bytes += m.len;
+      ingestRings[INGEST_COMMAND].release();
+      any = true;
+    }
+    if ( any )
+      last = hostSeconds();
+    else
+      std::this_thread::yield();
+  }
+  writer.join();
+  CHECK_EQ( bytes, stream.size() );
+
+  // the two lanes interleave back into the records sent
+  size_t d = 0, c = 0;
+  int misplaced = 0;
+  for (const std::string& r : expected) {
+    if ( c < lifted.size() && lifted[c] == r )
+      c++;
+    else if ( d < data.size() && data[d] == r )
+      d++;
+    else if ( misplaced++ < 5 )
+      printf( "    record %zu of the data lane and %zu of the commands do not follow the stream\n", d, c );
+  }
+  CHECK_EQ( misplaced, 0 );
+  CHECK_EQ( d, data.size() );
+  CHECK_EQ( c, lifted.size() );
+  CHECK_EQ( lifted.size(), SerialTask::serialStats.commands );
+  CHECK( lifted.size() > 0 );
+  printf( "pattern queue of %d: %zu of %d commands lifted, %zu records on the data lane, %u partial reads\n",
+          SERIAL_PATTERN_QUEUE_LEN, lifted.size(), commands, data.size(),
+          SerialTask::serialStats.partialReads );
+  hostExit( hostResult() );
+}
@@ -0,0 +1,74 @@
+// Frame pacing: the display task runs as on the board, and this thread
+// pushes lines into the serial ring.
+//
+//   idle   a line pushed while the task sleeps out WAIT_IDLE_MS wakes it
+//          and is flushed within a frame interval, not a polling period
+//   burst  a line every 2 ms for half a second is coalesced into at most
+//          one frame per frame interval of the burst, plus the frame that
+//          flushes its first line at once
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "DisplayTask.hpp"
+#include <string>
+#include <thread>
+#include <math.h>
+
+using namespace DisplayTask;
+
+static const double frameSeconds = 1.0 / MAX_FRAME_RATE;
+
+static volatile DisplayStats& stats( void ) {
+  return (volatile DisplayStats&) displayStats;
+}
+
+static void push( const std::string& line ) {
+  while ( !pushData( INGEST_SERIAL, line.data(), (int) line.size() ) )
+    std::this_thread::yield();
+}
+
+// until the display task has flushed expected messages, seconds it took
+static double flushed( uint32_t expected, double start ) {
+  while ( stats().latencyMessages < expected && hostSeconds() - start < 2 )
+    std::this_thread::yield();
+  CHECK_EQ( stats().latencyMessages, expected );
+  return hostSeconds() - start;
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  xTaskCreate( &taskFunction, "DisplayTask", 4096, NULL, 5, NULL );
+  vTaskDelay( 50 );
+
+  // idle, so the task is well into its WAIT_IDLE_MS wait
+  for (int i=0; i<3; i++) {
+    vTaskDelay( WAIT_IDLE_MS / 4 );
+    uint32_t messages = stats().latencyMessages;
+    double start = hostSeconds();
+    push( "idle::" + std::to_string( i ) + "\n" );
+    double seconds = flushed( messages + 1, start );
+    CHECK( seconds < frameSeconds );
+    printf( "idle:  line flushed %.2f ms after the push\n", seconds * 1e3 );
+  }
+
+  vTaskDelay( WAIT_IDLE_MS / 4 );
+  uint32_t frames = stats().frames, samples = stats().samples;
+  int lines = 0;
+  double start = hostSeconds();
+  while ( hostSeconds() - start < 0.5 ) {
+    push( "burst::" + std::to_string( lines++ % 100 ) + "\n" );
+    vTaskDelay( 2 );
+  }
+  double seconds = hostSeconds() - start;
+  // lines pushed between two drains are applied as one message
+  while ( stats().samples < samples + lines && hostSeconds() - start < 2 )
+    std::this_thread::yield();
+  CHECK_EQ( stats().samples, samples + lines );
+  vTaskDelay( 2 * 1000 / MAX_FRAME_RATE );
+  uint32_t burstFrames = stats().frames - frames;
+  uint32_t limit = (uint32_t) ceil( seconds * MAX_FRAME_RATE ) + 1;
+  CHECK( burstFrames <= limit );
+  printf( "burst: %d lines over %.0f ms in %u frames, at most %u, mean latency %u us\n",
+          lines, seconds * 1e3, burstFrames, limit, stats().latencyMeanUs );
+  hostExit( hostResult() );
+}
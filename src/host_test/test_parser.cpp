@@ -0,0 +1,199 @@
+// LineParser: how lines are classified and what they carry, values at the
+// ends of the sample range, random input that must neither crash nor lose
+// count of lines, and the parse rate over a telemetry stream with the
+// allocations it makes per line, which must be none.
+
+#include "HostTest.hpp"
+#include "LineParser.hpp"
+#include <stdlib.h>
+#include <new>
+#include <string>
+
+using namespace DisplayTask;
+
+static uint64_t allocations = 0;
+
+void* operator new( size_t size ) {
+  allocations++;
+  void* p = malloc( size ? size : 1 );
+  if ( p == nullptr )
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete( void* p ) noexcept {
+  free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept {
+  free( p );
+}
+
+static const int one = 1 << SAMPLE_FRAC_BITS;
+
+struct Case {
+  const char* input;
+  Line::Kind  kind;
+  const char* name;
+  int         value;
+};
+
+static const Case cases[] = {
+  { "temp::21",            Line::DATA,    "temp",    21 * one },
+  { "temp::-3.5\r",        Line::DATA,    "temp",    -7 * one / 2 },
+  { "a b::  7 ",           Line::DATA,    "a b",     7 * one },
+  { "x::1,2,3",            Line::DATA,    "x",       1 * one },
+  { "x::1e2",              Line::DATA,    "x",       100 * one },
+  { "+++CLEAR PLOTS",      Line::COMMAND, "CLEAR PLOTS", 0 },
+  { "say +++STATS",        Line::COMMAND, "STATS",   0 },
+  { "a::1 +++SPAN PLOTS:5", Line::COMMAND, "SPAN PLOTS:5", 0 },
+  { "temp::",              Line::TEXT,    "",        0 },
+  { "temp::abc",           Line::TEXT,    "",        0 },
+  { "temp::12x",           Line::TEXT,    "",        0 },
+  { "just text",           Line::TEXT,    "",        0 },
+  { "\n",                  Line::TEXT,    "",        0 },
+  { "a:b::c",              Line::TEXT,    "",        0 },
+  { "++ not a command",    Line::TEXT,    "",        0 },
+};
+
+static void checkCases( void ) {
+  ParseStats stats = {};
+  for (const Case& c : cases) {
+    LineParser parser( c.input, strlen( c.input ), stats );
+    Line line;
+    if ( !CHECK( parser.next( line ) ) )
+      continue;
+    if ( !CHECK( line.kind == c.kind ) ) {
+      printf( "    in \"%s\"\n", c.input );
+      continue;
+    }
+    if ( c.kind != Line::TEXT )
+      CHECK( line.name == StrView( c.name ) );
+    if ( c.kind == Line::DATA )
+      CHECK_EQ( line.value, c.value );
+  }
+
+  // a batch gives every value, switching plots at ';'
+  const char batch[] = "a::1,2;b::3\n";
+  LineParser parser( batch, sizeof(batch) - 1, stats );
+  Line line;
+  CHECK( parser.next( line ) );
+  std::string seen = std::string( line.name.data, line.name.len ) + std::to_string( line.value / one );
+  while ( parser.nextSample( line ) )
+    seen += std::string( line.name.data, line.name.len ) + std::to_string( line.value / one );
+  CHECK( seen == "a1a2b3" );
+  CHECK( !parser.next( line ) );
+
+  // a value running into the end of a cut chunk is not trusted
+  const char cut[] = "a::12";
+  LineParser cutParser( cut, sizeof(cut) - 1, stats, true );
+  CHECK( cutParser.next( line ) && line.kind == Line::TEXT );
+}
+
+// values at and past the ends of the sample range, which saturate as
+// wholeToSample() does rather than turn the line into text
+static void checkRange( void ) {
+  const int largest = INT32_MAX >> SAMPLE_FRAC_BITS;
+  const struct { std::string input; int value; } values[] = {
+    { std::to_string( largest ),          wholeToSample( largest ) },
+    { std::to_string( largest ) + ".5",   wholeToSample( largest ) + one / 2 },
+    { std::to_string( largest + 1 ),      INT32_MAX },
+    { std::to_string( -largest ),         wholeToSample( -largest ) },
+    { std::to_string( -largest - 1 ),     INT32_MIN },
+    { std::to_string( -largest - 2 ),     INT32_MIN },
+    { "1e30",                             INT32_MAX },
+    { "-99999999999999999999",            INT32_MIN },
+  };
+  ParseStats stats = {};
+  for (const auto& v : values) {
+    std::string text = "x::" + v.input;
+    LineParser parser( text.data(), text.size(), stats );
+    Line line;
+    if ( !CHECK( parser.next( line ) && line.kind == Line::DATA ) ) {
+      printf( "    in \"%s\"\n", text.c_str() );
+      continue;
+    }
+    CHECK_EQ( line.value, v.value );
+  }
+  // in a batch as well
+  std::string batch = "x::" + std::to_string( largest + 1 ) + ",-1e9;y::3\n";
+  LineParser parser( batch.data(), batch.size(), stats );
+  Line line;
+  CHECK( parser.next( line ) && line.value == INT32_MAX );
+  CHECK( parser.nextSample( line ) && line.value == INT32_MIN );
+  CHECK( parser.nextSample( line ) && line.value == 3 * one );
+  CHECK_EQ( stats.badValues, 0 );
+
+  int whole;
+  CHECK( LineParser::parseValue( StrView( "1e12" ), whole ) && whole == largest );
+  CHECK( LineParser::parseValue( StrView( "-1e12" ), whole ) && whole == -largest - 1 );
+}
+
+// every line is counted as exactly one kind, whatever the input
+static void fuzz( void ) {
+  static const char alphabet[] = "ab:+-.,;eE0123456789 \t\r\n\xA5";
+  char buf[ 512 ];
+  int bad = 0;
+  for (int round=0; round<20000; round++) {
+    int len = rand() % sizeof(buf);
+    for (int i=0; i<len; i++)
+      buf[i] = rand() % 8 == 0 ? rand() : alphabet[ rand() % (sizeof(alphabet) - 1) ];
+    ParseStats stats = {};
+    LineParser parser( buf, len, stats, rand() % 2 );
+    Line line;
+    int lines = 0;
+    while ( parser.next( line ) ) {
+      lines++;
+      if ( line.text.data < buf || line.text.data + line.text.len > buf + len )
+        bad++;
+      if ( line.kind == Line::DATA )
+        while ( parser.nextSample( line ) )
+          if ( line.name.data < buf || line.name.data + line.name.len > buf + len )
+            bad++;
+    }
+    if ( lines != (int) stats.lines || stats.lines != stats.dataLines + stats.commands + stats.textLines )
+      bad++;
+  }
+  CHECK_EQ( bad, 0 );
+}
+
+int main( void ) {
+  checkCases();
+  checkRange();
+  srand( 12 );
+  fuzz();
+
+  // what a board typically sends: a few sensors, the odd log line
+  std::string stream;
+  const char* sensors[] = { "temp", "humidity", "accel/x", "accel/y", "accel/z", "battery" };
+  for (int i=0; i<20000; i++) {
+    if ( i % 50 == 0 )
+      stream += "boot ok, heap " + std::to_string( 100000 + i ) + "\n";
+    else
+      stream += std::string( sensors[ i % 6 ] ) + "::" + std::to_string( rand() % 2000 - 1000 ) +
+        "." + std::to_string( rand() % 100 ) + "\r\n";
+  }
+
+  ParseStats stats = {};
+  const int passes = 200;
+  long sum = 0;
+  uint64_t before = allocations;
+  double start = hostSeconds();
+  for (int pass=0; pass<passes; pass++) {
+    LineParser parser( stream.data(), stream.size(), stats );
+    Line line;
+    while ( parser.next( line ) )
+      sum += line.value + line.name.len;
+  }
+  double seconds = hostSeconds() - start;
+  uint64_t made = allocations - before;
+  hostKeep( sum );
+
+  CHECK_EQ( made, 0 );
+  CHECK_EQ( stats.dataLines, passes * 19600 );
+  CHECK_EQ( stats.textLines, passes * 400 );
+  printf( "%.1f M lines/s, %.1f MB/s, %.3f allocations per line\n",
+          stats.lines / seconds / 1e6, stream.size() * (double) passes / seconds / 1e6,
+          (double) made / stats.lines );
+  return hostResult();
+}
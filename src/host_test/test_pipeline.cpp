@@ -0,0 +1,87 @@
+// Scanout pipeline: palette conversion of one buffer overlaps with the bus
+// sending the other.  The mock panel is given a bandwidth that makes the
+// wire time X about the conversion time C, and a frame taking T then has
+// an overlap efficiency of (C + X - T) / min(C, X): 1 when the two fully
+// overlap, 0 when they run one after the other.  The same scanout on a bus
+// that drains after every burst is the serial baseline.
+//
+// Landing a burst in panel memory costs the mock CPU time a DMA bus does
+// not have; it is timed on its own and taken out of T.
+//
+// A burst only lands on the mock panel once the next bus call has waited
+// for it, so a buffer refilled while still on the wire shows up as panel
+// pixels that differ from vram.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include <stdlib.h>
+#include <algorithm>
+
+static void serialWritePixels( const uint32_t* words, const int numPixels ) {
+  MockPanel::bus.write_pixels( words, numPixels );
+  MockPanel::bus.wait();
+}
+
+static void dropPixels( const uint32_t*, const int ) {}
+
+// the best of a few runs, a shared host only ever makes frames slower
+static double frameSeconds( int frames ) {
+  double best = 1e9;
+  for (int run=0; run<5; run++) {
+    double start = hostSeconds();
+    for (int f=0; f<frames; f++)
+      display_vram();
+    best = std::min( best, (hostSeconds() - start) / frames );
+  }
+  return best;
+}
+
+static double efficiency( double c, double x, double t ) {
+  return (c + x - t) / (c < x ? c : x);
+}
+
+int main( void ) {
+  lcd_bus_s serialBus = MockPanel::bus;
+  serialBus.write_pixels = serialWritePixels;
+  lcd_bus_s nullBus = MockPanel::bus;
+  nullBus.write_pixels = dropPixels;
+
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+  srand( 3 );
+  for (int i=0; i<DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+    vram[i] = rand();
+
+  const int frames = 20;
+  frameSeconds( 10 );
+  double landing = frameSeconds( frames );
+  lcd_set_bus( &nullBus );
+  double c = frameSeconds( frames );
+  landing -= c;
+  double bytes = DISPLAY_WIDTH * DISPLAY_HEIGHT * 2;
+  double rate = bytes / c;
+  double x = bytes / rate;
+
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::setBytesPerSecond( rate );
+  MockPanel::reset();
+  double pipelined = frameSeconds( frames ) - landing;
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+  CHECK_EQ( MockPanel::stats().outOfWindow, 0 );
+
+  lcd_set_bus( &serialBus );
+  MockPanel::reset();
+  double serial = frameSeconds( frames ) - landing;
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+
+  double overlap = efficiency( c, x, pipelined );
+  printf( "conversion %.3f ms, wire %.3f ms (%.1f MB/s), mock landing %.3f ms per frame\n",
+          c * 1000, x * 1000, rate / 1e6, landing * 1000 );
+  printf( "pipelined  %.3f ms per frame, overlap efficiency %.2f\n", pipelined * 1000, overlap );
+  printf( "serial     %.3f ms per frame, overlap efficiency %.2f\n", serial * 1000, efficiency( c, x, serial ) );
+  // loose, so a busy build machine does not fail it
+  CHECK( overlap > 0.3 );
+  CHECK( pipelined < serial );
+  return hostResult();
+}
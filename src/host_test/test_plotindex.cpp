@@ -0,0 +1,81 @@
+// Plot name index: lookups find the plot each name was created as, miss
+// names that were never created, and stay right after plots are removed.
+// Lookup cost at 10, 100 and 1000 series, against comparing the name with
+// every plot's std::string as getPlotIndex() used to.  Built with
+// MAX_PLOTS=1000.
+
+#include "HostTest.hpp"
+#include "DisplayTask.hpp"
+#include <stdlib.h>
+#include <vector>
+#include <string>
+
+using namespace DisplayTask;
+
+static int linearIndex( const std::vector<std::string>& names, const std::string& name ) {
+  for (size_t i=0; i<names.size(); i++)
+    if ( names[i] == name )
+      return i;
+  return -1;
+}
+
+static void run( int series ) {
+  std::vector<std::string> names;
+  char buf[ 48 ];
+  graphDisplay.clearPlots();
+  for (int i=0; i<series; i++) {
+    snprintf( buf, sizeof(buf), "node%d/temperature", i );
+    names.push_back( buf );
+    CHECK_EQ( graphDisplay.plotId( names.back() ), i );
+  }
+
+  int wrong = 0;
+  for (int i=0; i<series; i++)
+    if ( graphDisplay.plotId( names[i], false ) != i )
+      wrong++;
+  CHECK_EQ( wrong, 0 );
+  CHECK_EQ( graphDisplay.plotId( "node/missing", false ), -1 );
+
+  // a pass of lookups in random order, as lines arrive
+  const int lookups = 2000000;
+  std::vector<int> order( 4096 );
+  for (int& o : order)
+    o = rand() % series;
+  std::vector<StrView> views;
+  for (const std::string& n : names)
+    views.push_back( StrView( n ) );
+
+  long sum = 0;
+  double start = hostSeconds();
+  for (int i=0; i<lookups; i++)
+    sum += graphDisplay.plotId( views[ order[ i & 4095 ] ], false );
+  double indexed = (hostSeconds() - start) / lookups * 1e9;
+
+  int linearLookups = lookups / (series >= 1000 ? 100 : series >= 100 ? 10 : 1);
+  start = hostSeconds();
+  for (int i=0; i<linearLookups; i++)
+    sum += linearIndex( names, names[ order[ i & 4095 ] ] );
+  double linear = (hostSeconds() - start) / linearLookups * 1e9;
+  hostKeep( sum );
+
+  // removing a plot moves the ones after it down a slot
+  int removed = series / 2;
+  graphDisplay.removePlot( names[removed] );
+  names.erase( names.begin() + removed );
+  wrong = 0;
+  for (int i=0; i<series - 1; i++)
+    if ( graphDisplay.plotId( names[i], false ) != linearIndex( names, names[i] ) )
+      wrong++;
+  CHECK_EQ( wrong, 0 );
+
+  printf( "%4d series: %6.1f ns per lookup indexed, %8.1f ns comparing every name\n",
+          series, indexed, linear );
+}
+
+int main( void ) {
+  srand( 11 );
+  run( 10 );
+  run( 100 );
+  run( 1000 );
+  return hostResult();
+}
@@ -0,0 +1,144 @@
+// Render cost against history: one plot drawn and flushed to the mock
+// panel at spans from DISPLAY_WIDTH to PLOT_HISTORY_LEN, built with the
+// history PSRAM boards keep.  Past DISPLAY_WIDTH each pixel column is one
+// min/max query on the pyramid, so the time per frame must not grow
+// while the span grows 64 fold; the queries are also timed alone, next
+// to a scan of every sample shown.  At every span a single-sample spike at random
+// positions must reach its own y in the column it falls in.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "DisplayTask.hpp"
+#include "VramLayout.hpp"
+#include <stdlib.h>
+#include <climits>
+#include <vector>
+#include <algorithm>
+
+using namespace DisplayTask;
+
+static const int graphTop = 0, graphBottom = 200;
+static const int noise    = 100;     // whole units
+static const int spike    = 100000;
+
+static GraphDisplay graph( 0, DISPLAY_WIDTH, graphTop, graphBottom );
+
+// a fresh plot, its history full of noise
+static int fill( void ) {
+  int id = graph.createPlot( "render", true );
+  graph.setBinWidth( id, 1 );
+  for (int i=0; i<PLOT_HISTORY_LEN; i++)
+    graph.addData( id, wholeToSample( rand() % noise ) );
+  return id;
+}
+
+static bool drawn( int x, int y, uint8_t color ) {
+  return y >= graphTop && y <= graphBottom && vram[ vram_layout::index( x, y ) ] == color;
+}
+
+// the spike at sample k of the span, negative every other time
+static bool spikeReached( int span, int k, bool up ) {
+  int id = fill();
+  const GraphDisplay::Plot& plot = graph.plot( id );
+  // bins of one sample, so the spike is a point of its own
+  int value = wholeToSample( up ? spike : -spike );
+  graph.addData( id, value );
+  for (int i=0; i<span-1-k; i++)
+    graph.addData( id, wholeToSample( rand() % noise ) );
+  graph.drawPlots();
+  if ( (up ? plot.max : plot.min) != value )
+    return false;
+  int y = graphBottom - (int) ((((int64_t) value - plot.min) * plot.yScale) >> 32);
+  // one point per xStep pixels up to DISPLAY_WIDTH, past it column c
+  // shows the samples from c * span / columns on, rounded down
+  int columns = DISPLAY_WIDTH;
+  int x = k * (columns / span);
+  if ( span > columns ) {
+    x = (int) ((int64_t) k * columns / span);
+    while ( (int64_t) (x + 1) * span / columns <= k )
+      x++;
+  }
+  return drawn( x, y, plot.color );
+}
+
+// seconds per frame at span, each frame one new sample, best of 5 runs
+static double frameSeconds( int id, int frames ) {
+  double best = 1e9;
+  for (int run=0; run<5; run++) {
+    double start = hostSeconds();
+    for (int f=0; f<frames; f++) {
+      graph.addData( id, wholeToSample( rand() % noise ) );
+      graph.drawPlots();
+      flush_vram();
+    }
+    best = std::min( best, (hostSeconds() - start) / frames );
+  }
+  return best;
+}
+
+// the ranges of a frame's columns, from the pyramid or by scanning every
+// sample they cover
+static double columnSeconds( const GraphDisplay::Plot& plot, int span, int frames, bool scan ) {
+  double start = hostSeconds();
+  long sum = 0;
+  for (int f=0; f<frames; f++)
+    for (int c=0; c<DISPLAY_WIDTH; c++) {
+      uint32_t s0 = plot.seq - span + (uint32_t) ((int64_t) c * span / DISPLAY_WIDTH);
+      uint32_t s1 = plot.seq - span + (uint32_t) ((int64_t) (c + 1) * span / DISPLAY_WIDTH);
+      GraphDisplay::Range r = { INT_MAX, INT_MIN };
+      if ( !scan )
+        r = plot.query( s0, s1 - s0 );
+      else
+        for (uint32_t s=s0; s<s1; s++) {
+          r.min = std::min( r.min, plot.at( s ) );
+          r.max = std::max( r.max, plot.at( s ) );
+        }
+      sum += r.max - r.min;
+    }
+  hostKeep( sum );
+  return (hostSeconds() - start) / frames;
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+  clear_vram();
+  display_vram();
+  srand( 10 );
+
+  std::vector<int> spans;
+  for (int span=DISPLAY_WIDTH; span<PLOT_HISTORY_LEN; span*=2)
+    spans.push_back( span );
+  spans.push_back( PLOT_HISTORY_LEN );
+
+  std::vector<double> times;
+  for (int span : spans) {
+    graph.setSpan( span );
+    int missed = 0;
+    for (int t=0; t<20; t++) {
+      int k = rand() % span;
+      if ( !spikeReached( span, k, t % 2 == 0 ) ) {
+        if ( missed++ == 0 )
+          printf( "    span %d: spike at sample %d not drawn\n", span, k );
+      }
+    }
+    CHECK_EQ( missed, 0 );
+
+    int id = fill();
+    graph.drawPlots();
+    double frame = frameSeconds( id, 50 );
+    double query = columnSeconds( graph.plot( id ), span, 200, false );
+    double scan  = columnSeconds( graph.plot( id ), span, 200, true );
+    times.push_back( frame );
+    printf( "span %5d: %6.1f us per frame, column ranges %5.1f us from the pyramid, %6.1f us scanned\n",
+            span, frame * 1e6, query * 1e6, scan * 1e6 );
+  }
+  // flat: no span costs more than DISPLAY_WIDTH did, give or take the
+  // noise of a shared host; wider spans draw shorter column lines, so if
+  // anything they get cheaper
+  for (size_t i=1; i<spans.size(); i++)
+    if ( !CHECK( times[i] < 2.5 * times[0] ) )
+      printf( "    span %d takes %.2f times span %d\n", spans[i], times[i] / times[0], spans[0] );
+  return hostResult();
+}
@@ -0,0 +1,140 @@
+// IngestRing: a producer thread pushing and a consumer thread peeking at
+// the same time, every message checked for its bytes, its stamp and its
+// order.  Half the messages go through push() and half are written in
+// place through reserve() and commit().  Then a single threaded run
+// against a queue model, where full pushes must drop whole messages and
+// keep the rest in order.
+
+#include "HostTest.hpp"
+#include "IngestRing.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <deque>
+#include <string>
+
+using namespace DisplayTask;
+
+static IngestRing ring;
+
+static int lengthOf( uint32_t seq ) {
+  uint32_t h = seq * 2654435761u;
+  // mostly lines, now and then a long one that has to wrap
+  return h % 16 == 0 ? 1 + (h >> 8) % IngestRing::maxMessage : 1 + (h >> 8) % 48;
+}
+
+static void fill( char* p, uint32_t seq, int len ) {
+  for (int i=0; i<len; i++)
+    p[i] = (char) (seq * 31 + i);
+}
+
+static bool matches( StrView m, uint32_t seq ) {
+  if ( m.len != lengthOf( seq ) )
+    return false;
+  for (int i=0; i<m.len; i++)
+    if ( m.data[i] != (char) (seq * 31 + i) )
+      return false;
+  return true;
+}
+
+static void stress( uint32_t messages ) {
+  uint32_t outOfOrder = 0;
+  uint64_t bytes = 0;
+  double start = hostSeconds();
+  std::thread producer( [messages] {
+      char msg[ IngestRing::maxMessage ];
+      for (uint32_t seq=0; seq<messages; ) {
+        int len = lengthOf( seq );
+        if ( seq % 2 == 0 ) {
+          fill( msg, seq, len );
+          if ( ring.push( msg, len, seq ) )
+            seq++;
+          else
+            std::this_thread::yield();
+        }
+        else {
+          int room = len;
+          char* p = ring.reserve( room );
+          if ( p != nullptr && room == len ) {
+            fill( p, seq, len );
+            ring.commit( len, seq );
+            seq++;
+          }
+          else
+            std::this_thread::yield();
+        }
+      }
+    } );
+  for (uint32_t seq=0; seq<messages; ) {
+    StrView m;
+    uint32_t stamp;
+    // yielding keeps a single core host from spinning out its time slice
+    if ( !ring.peek( m, &stamp ) ) {
+      std::this_thread::yield();
+      continue;
+    }
+    if ( stamp != seq || !matches( m, seq ) )
+      outOfOrder++;
+    bytes += m.len;
+    ring.release();
+    seq++;
+  }
+  producer.join();
+  double seconds = hostSeconds() - start;
+  CHECK_EQ( outOfOrder, 0 );
+  CHECK_EQ( ring.used(), 0 );
+  printf( "two threads: %.1f M messages/s, %.0f MB/s, high water %u bytes\n",
+          messages / seconds / 1e6, bytes / seconds / 1e6, ring.stats().highWater );
+}
+
+// one thread, the ring against a queue of what was accepted
+static void model( void ) {
+  static IngestRing single;
+  std::deque< std::pair<uint32_t, int> > accepted;
+  char msg[ IngestRing::maxMessage ];
+  int bad = 0, dropped = 0, pushDropped = 0;
+  for (uint32_t seq=0; seq<200000; seq++) {
+    int len = lengthOf( seq );
+    fill( msg, seq, len );
+    bool ok;
+    if ( seq % 3 == 0 ) {
+      int room = len;
+      char* p = single.reserve( room );
+      ok = p != nullptr && room == len;
+      if ( ok ) {
+        memcpy( p, msg, len );
+        single.commit( len, seq );
+      }
+    }
+    else {
+      ok = single.push( msg, len, seq );
+      pushDropped += !ok;
+    }
+    if ( ok )
+      accepted.push_back( std::make_pair( seq, len ) );
+    else
+      dropped++;
+    // the consumer keeps up only some of the time
+    int take = rand() % 3;
+    while ( take-- > 0 && !accepted.empty() ) {
+      StrView m;
+      uint32_t stamp;
+      if ( !single.peek( m, &stamp ) || stamp != accepted.front().first || !matches( m, stamp ) )
+        bad++;
+      single.release();
+      accepted.pop_front();
+    }
+  }
+  CHECK_EQ( bad, 0 );
+  CHECK( dropped > 0 );
+  // reserve() leaves counting to its caller, pushes count themselves
+  CHECK_EQ( single.stats().overflows, pushDropped );
+  printf( "model: %d of 200000 messages dropped while full, none reordered\n", dropped );
+}
+
+int main( void ) {
+  srand( 13 );
+  model();
+  stress( 2000000 );
+  return hostResult();
+}
@@ -0,0 +1,90 @@
+// Full frame scanout: display_vram() windows the panel once and streams
+// the frame, against the old per-row scanout (a window and a burst for
+// every row), rebuilt here on the same bus.  Both must leave the same
+// image on the panel; the transactions and bytes each needs are printed.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "VramLayout.hpp"
+#include <stdlib.h>
+
+static lcd_bus_stats_s rowStats;
+
+static void rowCommand( uint8_t cmd ) {
+  rowStats.transactions++;
+  rowStats.command_bytes++;
+  MockPanel::bus.write_command( cmd );
+}
+
+static void rowData( const uint8_t* data, uint32_t len ) {
+  rowStats.transactions++;
+  rowStats.data_bytes += len;
+  MockPanel::bus.write_data( data, len );
+}
+
+// what ili9341_write_frame() did before: CASET, PASET and RAMWR per row
+static void perRowScanout( void ) {
+  static uint32_t row[ DISPLAY_WIDTH / 2 ];
+  for (int y=0; y<DISPLAY_HEIGHT; y++) {
+    const uint8_t col[4]  = { 0, 0, (DISPLAY_WIDTH - 1) >> 8, (DISPLAY_WIDTH - 1) & 0xFF };
+    const uint8_t page[4] = { (uint8_t) (y >> 8), (uint8_t) y, (uint8_t) (y >> 8), (uint8_t) y };
+    rowCommand( ILI9341_CASET );
+    rowData( col, 4 );
+    rowCommand( ILI9341_PASET );
+    rowData( page, 4 );
+    rowCommand( ILI9341_RAMWR );
+    vram_layout::convert_span( vram, 0, y, DISPLAY_WIDTH, myPalette, (uint16_t*) row );
+    rowStats.transactions++;
+    rowStats.data_bytes += DISPLAY_WIDTH * 2;
+    MockPanel::bus.write_pixels( row, DISPLAY_WIDTH );
+  }
+  MockPanel::bus.wait();
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+  srand( 2 );
+  for (int i=0; i<DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+    vram[i] = rand();
+
+  const int frames = 200;
+
+  lcd_reset_bus_stats();
+  MockPanel::resetStats();
+  double start = hostSeconds();
+  for (int f=0; f<frames; f++)
+    display_vram();
+  double windowSeconds = hostSeconds() - start;
+  lcd_bus_stats_s window = lcd_get_bus_stats();
+  MockPanel::Stats windowPanel = MockPanel::stats();
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+  CHECK_EQ( windowPanel.windows, frames );
+  CHECK_EQ( windowPanel.outOfWindow, 0 );
+  CHECK_EQ( windowPanel.pixels, (uint32_t) frames * DISPLAY_WIDTH * DISPLAY_HEIGHT );
+
+  MockPanel::reset();
+  MockPanel::resetStats();
+  start = hostSeconds();
+  for (int f=0; f<frames; f++)
+    perRowScanout();
+  double rowSeconds = hostSeconds() - start;
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+  CHECK_EQ( MockPanel::stats().windows, (uint32_t) frames * DISPLAY_HEIGHT );
+
+  // the frame itself is the same, only the window setup goes away
+  uint32_t pixelBytes = DISPLAY_WIDTH * DISPLAY_HEIGHT * 2;
+  CHECK( window.data_bytes / frames >= pixelBytes );
+  CHECK( window.data_bytes < rowStats.data_bytes );
+  CHECK( window.transactions * 10 < rowStats.transactions );
+
+  printf( "per frame        transactions  command bytes  data bytes  host ms\n" );
+  printf( "one window       %12u  %13u  %10u  %7.3f\n",
+          window.transactions / frames, window.command_bytes / frames,
+          window.data_bytes / frames, windowSeconds * 1000 / frames );
+  printf( "window per row   %12u  %13u  %10u  %7.3f\n",
+          rowStats.transactions / frames, rowStats.command_bytes / frames,
+          rowStats.data_bytes / frames, rowSeconds * 1000 / frames );
+  return hostResult();
+}
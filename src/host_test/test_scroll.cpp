@@ -0,0 +1,129 @@
+// Log pane scrolling: the mock panel composes what is on the glass from
+// its memory through the scroll registers, and after every frame the
+// pane must show the last maxLogs lines as a redraw without scrolling
+// would, over more lines than the pane holds so the scroll offset and
+// the ring of lines both wrap.  A new line costs one logHeight strip of
+// pixels (rounded out to hash tiles when tile hashing is on) and the
+// VSCRSADD write.  Built with and without tile hashing.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "DisplayTask.hpp"
+#include "Fonts.hpp"
+#include <string>
+#include <deque>
+
+using namespace DisplayTask;
+
+static const int paneTop  = 200;
+static const int bandTop  = paneTop + TextDisplay::logHeight;  // first line scrolls from here
+static const int tileSize = 16;  // HASH_TILE_SIZE in Display.cpp
+
+// the line i of text shows at x,y of its line, as Draw_8x12_string draws it
+static uint16_t textColor( const std::string& text, int x, int y ) {
+  int i = x / FONT_8X12_ADVANCE, col = x % FONT_8X12_ADVANCE;
+  bool on = i < (int) text.size() && col < 8 &&
+            (char8x12_matrix[ (uint8_t) text[i] ][ y ] >> (7 - col)) & 1;
+  return myPalette[ on ? 0xFF : 0x00 ];
+}
+
+// pixels of the scrolling band that differ from the lines, oldest first
+static int paneMismatches( const std::deque<std::string>& lines ) {
+  int bad = 0;
+  for (int y=0; y<TextDisplay::maxLogs * TextDisplay::logHeight; y++)
+    for (int x=0; x<DISPLAY_WIDTH; x++)
+      if ( MockPanel::shown( x, bandTop + y ) !=
+           textColor( lines[ y / TextDisplay::logHeight ], x, y % TextDisplay::logHeight ) )
+        bad++;
+  return bad;
+}
+
+static int commands( uint8_t cmd ) {
+  int count = 0;
+  for (const MockPanel::WireByte& b : MockPanel::trace())
+    if ( b.dc == 0 && b.value == cmd )
+      count++;
+  return count;
+}
+
+static std::string line( int n ) {
+  // some cut at maxLogLen, some exactly as long, the rest shorter
+  int len = n % 3 == 0 ? TextDisplay::maxLogLen + 5 :
+            n % 3 == 1 ? TextDisplay::maxLogLen : 8 + n % 11;
+  std::string text = "line " + std::to_string( n ) + " ";
+  while ( (int) text.size() < len )
+    text += (char) ('A' + (text.size() + n) % 26);
+  return text.substr( 0, len );
+}
+
+int main( void ) {
+  // a full line fits the pane, its last character included
+  CHECK( (TextDisplay::maxLogLen - 1) * FONT_8X12_ADVANCE + 8 <= DISPLAY_WIDTH );
+
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+  // the scroll model below holds for this rotation only
+  CHECK_EQ( MockPanel::madctl, 0b01101000 );
+  clear_vram();
+  display_vram();
+
+  TextDisplay pane( 0, DISPLAY_WIDTH, paneTop, DISPLAY_HEIGHT );
+  pane.init();
+  pane.drawLogs();
+  flush_vram();
+  std::deque<std::string> lines( TextDisplay::maxLogs, " " );
+  CHECK_EQ( MockPanel::scrollTop, bandTop );
+  CHECK_EQ( MockPanel::scrollHeight, TextDisplay::maxLogs * TextDisplay::logHeight );
+  CHECK_EQ( paneMismatches( lines ), 0 );
+
+  // a line a frame
+  int n = 0, frames = 0, badFrames = 0;
+  for (; n<3 * TextDisplay::maxLogs + 2; n++) {
+    MockPanel::resetStats();
+    MockPanel::clearTrace();
+    MockPanel::record( true );
+    pane.addLog( line( n ) );
+    pane.drawLogs();
+    flush_vram();
+    MockPanel::record( false );
+    lines.pop_front();
+    lines.push_back( line( n ).substr( 0, TextDisplay::maxLogLen ) );
+    frames++;
+
+    MockPanel::Stats stats = MockPanel::stats();
+    int strip = scroll_row( (TextDisplay::maxLogs - 1) * TextDisplay::logHeight );
+    int first = strip, last = strip + TextDisplay::logHeight - 1;
+    if ( CONFIG_VRAM_TILE_HASH ) {
+      first = first / tileSize * tileSize;
+      last  = (last / tileSize + 1) * tileSize - 1;
+    }
+    else
+      CHECK_EQ( stats.windows, 1 );
+    if ( !CHECK( stats.firstRow >= first && stats.lastRow <= last ) )
+      printf( "    line %d: rows %d to %d sent, the strip is %d to %d\n", n, stats.firstRow, stats.lastRow, first, last );
+    CHECK( stats.pixels <= (uint32_t) (DISPLAY_WIDTH * (last - first + 1)) );
+    CHECK_EQ( commands( ILI9341_VSCRSADD ), 1 );
+    CHECK_EQ( commands( ILI9341_VSCRDEF ), 0 );
+    if ( paneMismatches( lines ) != 0 || MockPanel::mismatches() != 0 )
+      badFrames++;
+  }
+
+  // several lines in one frame, and more than the pane holds
+  const int bursts[] = { 3, TextDisplay::maxLogs - 1, TextDisplay::maxLogs + 2, 1 };
+  for (int burst : bursts) {
+    for (int i=0; i<burst; i++, n++) {
+      pane.addLog( line( n ) );
+      lines.pop_front();
+      lines.push_back( line( n ).substr( 0, TextDisplay::maxLogLen ) );
+    }
+    pane.drawLogs();
+    flush_vram();
+    frames++;
+    if ( paneMismatches( lines ) != 0 || MockPanel::mismatches() != 0 )
+      badFrames++;
+  }
+  CHECK_EQ( badFrames, 0 );
+  printf( "%d lines over %d frames, scroll start at line %d\n", n, frames, MockPanel::scrollStart );
+  return hostResult();
+}
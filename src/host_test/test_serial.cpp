@@ -0,0 +1,76 @@
+// Serial throughput: the serial and display tasks run as on the board,
+// the serial task reading a pty through HostUart.cpp while this thread
+// writes telemetry lines into the other end as fast as it takes them.
+// With RTS/CTS (SERIAL_FLOW_CONTROL) the writer is held back instead of
+// bytes being lost, so every sample must reach the plots; without, the
+// test only reports what was lost.  Sustained bytes per second are given
+// as the baud rate they would need, against SERIAL_BAUD_RATE.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "SerialTask.hpp"
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace DisplayTask;
+
+static uint32_t appliedSamples( void ) {
+  return ((volatile DisplayStats&) displayStats).samples;
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  xTaskCreate( &DisplayTask::taskFunction, "DisplayTask", 4096, NULL, 5, NULL );
+  xTaskCreate( &SerialTask::taskFunction, "SerialTask", 3072, NULL, 5, NULL );
+  int sender = hostUartSender();
+
+  // a block of lines for a few sensors, written over and over
+  std::string block;
+  const int blockLines = 1000;
+  for (int i=0; i<blockLines; i++)
+    block += "sensor" + std::to_string( i % 8 ) + "::" + std::to_string( (i * 37) % 2000 - 1000 ) +
+      "." + std::to_string( i % 10 ) + "\n";
+  const int blocks = 200;
+  const uint32_t lines = blocks * blockLines;
+
+  uint32_t before = appliedSamples();
+  double start = hostSeconds();
+  for (int b=0; b<blocks; b++)
+    for (size_t done=0; done<block.size(); ) {
+      ssize_t n = write( sender, block.data() + done, block.size() - done );
+      if ( n <= 0 )
+        break;
+      done += n;
+    }
+  // done once the samples stop coming
+  uint32_t seen = 0;
+  double last = hostSeconds();
+  while ( appliedSamples() - before < lines && hostSeconds() - last < 1 ) {
+    if ( appliedSamples() != seen ) {
+      seen = appliedSamples();
+      last = hostSeconds();
+    }
+    std::this_thread::yield();
+  }
+  double seconds = hostSeconds() - start;
+  uint32_t applied = appliedSamples() - before;
+  double bytes = (double) blocks * block.size();
+
+  SerialTask::SerialStats& s = SerialTask::serialStats;
+  printf( "%s: %.1f MB/s, as fast as %.0f baud (configured %d), %u of %u samples applied\n",
+          SERIAL_FLOW_CONTROL ? "rts/cts" : "no flow control",
+          bytes / seconds / 1e6, bytes * 10 / seconds, SERIAL_BAUD_RATE, applied, lines );
+  printf( "%u data events, %u buffer full, %u partial reads, %u reads put off for a full ring\n",
+          s.dataEvents, s.bufferFull, s.partialReads, s.ringFull );
+  if ( SERIAL_FLOW_CONTROL ) {
+    CHECK_EQ( applied, lines );
+    CHECK_EQ( s.bufferFull, 0 );
+    CHECK_EQ( s.bytes, bytes );
+    CHECK_EQ( parseStats.badValues, 0 );
+  }
+  else
+    CHECK( applied <= lines );
+  CHECK_EQ( s.commands, 0 );
+  hostExit( hostResult() );
+}
@@ -0,0 +1,264 @@
+// UDP senders against the source table and the plots, with the receive
+// task and the display task running as on the board.  Built with the
+// shipped UDP_MAX_SOURCES and MAX_PLOTS and short idle times, so twice as
+// many senders as slots and more series than plots:
+//
+//   load    32 senders blast datagrams at once: 16 get a slot and the
+//           others are turned away, every sample of the 16 is applied and
+//           their series fill the plots
+//   reuse   those go quiet and 16 new senders of the same series take
+//           over their slots, each slot's new generation drops the plots
+//           of the sender before rather than carrying on with them
+//   full    with every plot fed for longer than PLOT_IDLE_MS, the senders
+//           left without one are turned away and counted, and no plot is
+//           given up
+//   evict   half the plots go quiet for PLOT_IDLE_MS while the others are
+//           fed on: only the quiet ones are replaced
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "UDPReceiver.hpp"
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace DisplayTask;
+
+static const uint16_t port      = 47221;
+static const int      senders   = 2 * UDP_MAX_SOURCES;
+static const int      datagrams = 300;  // per sender, under load
+static const int      lines     = 10;   // per datagram
+static const int      inFlight  = 128;  // datagrams sent and not yet received, in all
+
+static uint32_t received( void ) {
+  return ((volatile UDPReceiver::UdpStats&) UDPReceiver::udpStats).datagrams;
+}
+
+// taken in or turned away
+static uint32_t handled( void ) {
+  return received() + ((volatile UDPReceiver::UdpStats&) UDPReceiver::udpStats).sourcesRejected;
+}
+
+static uint32_t appliedSamples( void ) {
+  return ((volatile DisplayStats&) displayStats).samples;
+}
+
+static std::atomic<uint32_t> sent( 0 );
+
+// a socket of its own, so a sender of its own to the receiver
+struct Sender {
+  int sock = socket( AF_INET, SOCK_DGRAM, 0 );
+  ~Sender() { close( sock ); }
+
+  bool send( const std::string& datagram ) {
+    // held back while the receiver is behind, so the kernel drops nothing
+    double start = hostSeconds();
+    while ( sent - handled() >= (uint32_t) inFlight ) {
+      if ( hostSeconds() - start > 5 )
+        return false;
+      std::this_thread::yield();
+    }
+    struct sockaddr_in to;
+    memset( &to, 0, sizeof(to) );
+    to.sin_family = AF_INET;
+    to.sin_port = htons( port );
+    to.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    if ( sendto( sock, datagram.data(), datagram.size(), 0, (struct sockaddr *) &to, sizeof(to) ) < 0 )
+      return false;
+    sent++;
+    return true;
+  }
+
+  // the plot name prefix of its slot in the source table, "" if it has none
+  std::string prefix( void ) const {
+    struct sockaddr_in self;
+    socklen_t len = sizeof(self);
+    getsockname( sock, (struct sockaddr *) &self, &len );
+    for (int i=0; i<UDP_MAX_SOURCES; i++)
+      if ( UDPReceiver::sources[i].active && UDPReceiver::sources[i].port == self.sin_port )
+        return std::to_string( i + 1 ) + "/";
+    return "";
+  }
+};
+
+typedef std::vector< std::unique_ptr<Sender> > Senders;
+
+static Senders makeSenders( int count ) {
+  Senders made;
+  for (int i=0; i<count; i++)
+    made.push_back( std::unique_ptr<Sender>( new Sender() ) );
+  return made;
+}
+
+// lines of single samples, going round the series named
+static std::string datagram( const std::vector<std::string>& series, int count, int value ) {
+  std::string d;
+  for (int l=0; l<count; l++)
+    d += series[ l % series.size() ] + "::" + std::to_string( (value + l) % 100 ) + "\n";
+  return d;
+}
+
+// until the receiver has taken every datagram sent and the display task
+// has applied the samples of those it took in
+static void settle( uint32_t samplesBefore, uint32_t receivedBefore, int perDatagram ) {
+  double start = hostSeconds();
+  while ( handled() < sent && hostSeconds() - start < 2 )
+    std::this_thread::yield();
+  CHECK_EQ( handled(), sent.load() );
+  uint32_t expected = samplesBefore + (received() - receivedBefore) * perDatagram;
+  uint32_t samples = appliedSamples();
+  double last = hostSeconds();
+  while ( samples < expected && hostSeconds() - last < 2 ) {
+    std::this_thread::yield();
+    if ( appliedSamples() != samples ) {
+      samples = appliedSamples();
+      last = hostSeconds();
+    }
+  }
+  CHECK_EQ( appliedSamples(), expected );
+  vTaskDelay( 20 );
+}
+
+static std::set<std::string> plotNames( void ) {
+  std::set<std::string> names;
+  for (int i=0; i<graphDisplay.numPlots(); i++)
+    names.insert( graphDisplay.plot( i ).name );
+  return names;
+}
+
+// every plot of a series named, from any slot
+static bool onlySeries( const std::set<std::string>& series ) {
+  for (const std::string& name : plotNames()) {
+    size_t slash = name.find( '/' );
+    if ( slash == std::string::npos || series.count( name.substr( slash + 1 ) ) == 0 )
+      return false;
+  }
+  return true;
+}
+
+static void load( void ) {
+  uint32_t before = appliedSamples(), receivedBefore = received();
+  double start = hostSeconds();
+  std::vector<std::thread> threads;
+  for (int s=0; s<senders; s++)
+    threads.push_back( std::thread( [s] {
+        Sender sender;
+        std::vector<std::string> series = { "a", "b" };
+        for (int i=0; i<datagrams; i++)
+          if ( !sender.send( datagram( series, lines, s * 13 + i ) ) )
+            break;
+      } ) );
+  for (std::thread& t : threads)
+    t.join();
+  settle( before, receivedBefore, lines );
+  double seconds = hostSeconds() - start;
+
+  CHECK_EQ( sent.load(), senders * datagrams );
+  CHECK_EQ( UDPReceiver::udpStats.sources, UDP_MAX_SOURCES );
+  CHECK( UDPReceiver::udpStats.sourcesRejected > 0 );
+  CHECK_EQ( graphDisplay.numPlots(), MAX_PLOTS );
+  CHECK( displayStats.plotsRejected > 0 );
+  CHECK( onlySeries( { "a", "b" } ) );
+  printf( "load:  %d senders, %u datagrams taken in at %.0f/s, %u turned away, %u receives waited for a buffer\n",
+          senders, received() - receivedBefore, (received() - receivedBefore) / seconds,
+          UDPReceiver::udpStats.sourcesRejected, UDPReceiver::udpStats.poolWaits );
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  xTaskCreate( &taskFunction, "DisplayTask", 4096, NULL, 5, NULL );
+  CHECK( UDPReceiver::start( port ) );
+  vTaskDelay( 50 );
+
+  load();
+
+  // the first senders leave the table, new ones get their slots and send
+  // "a" as well, values 0 to 9 only; the plots of the old ones are
+  // dropped on the new generation's first datagram, so no "b" is left
+  // and no "a" goes on with the history of the sender before
+  vTaskDelay( UDP_SOURCE_IDLE_MS + 2 * UDP_RATE_WINDOW_MS );
+  CHECK_EQ( UDPReceiver::udpStats.sources, 0 );
+  Senders newSenders = makeSenders( UDP_MAX_SOURCES );
+  uint32_t before = appliedSamples(), receivedBefore = received();
+  for (auto& sender : newSenders)
+    sender->send( datagram( { "a" }, lines, 0 ) );
+  settle( before, receivedBefore, lines );
+  CHECK_EQ( UDPReceiver::udpStats.sources, UDP_MAX_SOURCES );
+  CHECK_EQ( graphDisplay.numPlots(), MAX_PLOTS );
+  CHECK( onlySeries( { "a" } ) );
+  int inherited = 0;
+  for (int i=0; i<graphDisplay.numPlots(); i++) {
+    const GraphDisplay::Plot& plot = graphDisplay.plot( i );
+    if ( plot.query( plot.seq - PLOT_HISTORY_LEN, PLOT_HISTORY_LEN ).max > wholeToSample( lines - 1 ) )
+      inherited++;
+  }
+  CHECK_EQ( inherited, 0 );
+  printf( "reuse: %d plots after %u senders were replaced\n",
+          graphDisplay.numPlots(), UDPReceiver::udpStats.sourcesEvicted );
+
+  // every sender feeds its series for twice PLOT_IDLE_MS; those without
+  // a plot are turned away on every line, and no fed plot makes room
+  std::set<std::string> names = plotNames();
+  uint32_t evicted = displayStats.plotsEvicted, rejected = displayStats.plotsRejected;
+  before = appliedSamples();
+  receivedBefore = received();
+  double start = hostSeconds();
+  while ( hostSeconds() - start < 2 * PLOT_IDLE_MS / 1000.0 ) {
+    for (auto& sender : newSenders)
+      sender->send( datagram( { "a" }, 1, 0 ) );
+    vTaskDelay( 10 );
+  }
+  settle( before, receivedBefore, 1 );
+  CHECK( plotNames() == names );
+  CHECK_EQ( displayStats.plotsEvicted, evicted );
+  CHECK( displayStats.plotsRejected > rejected );
+  printf( "full:  %u new plots turned away\n", displayStats.plotsRejected - rejected );
+
+  // the senders of half the plots go on, the other half go quiet; after
+  // PLOT_IDLE_MS the senders without a plot replace the quiet plots only
+  std::vector<Sender*> fed, homeless;
+  std::set<std::string> fedNames;
+  for (auto& sender : newSenders) {
+    std::string name = sender->prefix() + "a";
+    if ( names.count( name ) == 0 )
+      homeless.push_back( sender.get() );
+    else if ( (int) fedNames.size() < MAX_PLOTS / 2 ) {
+      fed.push_back( sender.get() );
+      fedNames.insert( name );
+    }
+  }
+  CHECK_EQ( (int) homeless.size(), UDP_MAX_SOURCES - MAX_PLOTS );
+  evicted = displayStats.plotsEvicted;
+  rejected = displayStats.plotsRejected;
+  before = appliedSamples();
+  receivedBefore = received();
+  start = hostSeconds();
+  while ( hostSeconds() - start < PLOT_IDLE_MS / 1000.0 + 0.3 ) {
+    for (Sender* sender : fed)
+      sender->send( datagram( { "a" }, 1, 0 ) );
+    vTaskDelay( 10 );
+  }
+  for (Sender* sender : homeless)
+    sender->send( datagram( { "a" }, 1, 0 ) );
+  for (Sender* sender : fed)
+    sender->send( datagram( { "a" }, 1, 0 ) );
+  settle( before, receivedBefore, 1 );
+  names = plotNames();
+  CHECK_EQ( graphDisplay.numPlots(), MAX_PLOTS );
+  CHECK_EQ( displayStats.plotsEvicted - evicted, MAX_PLOTS - MAX_PLOTS / 2 );
+  CHECK_EQ( displayStats.plotsRejected - rejected,
+            (uint32_t) (homeless.size() - (MAX_PLOTS - MAX_PLOTS / 2)) );
+  for (const std::string& name : fedNames)
+    CHECK( names.count( name ) == 1 );
+  printf( "evict: %u quiet plots replaced, %u fed plots kept\n",
+          displayStats.plotsEvicted - evicted, (unsigned) fedNames.size() );
+  hostExit( hostResult() );
+}
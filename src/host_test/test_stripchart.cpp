@@ -0,0 +1,89 @@
+// Strip chart: after any run of scrolled frames, vram holds exactly what a
+// full redraw of the same plots draws.  The redraw is forced by changing
+// the span and changing it back.  Then the cost per sample of scrolling
+// against redrawing, at 1, 5 and 10 plots.
+
+#include "HostTest.hpp"
+#include "DisplayTask.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace DisplayTask;
+
+static uint8_t scrolled[ DISPLAY_WIDTH * DISPLAY_HEIGHT ];
+
+static void fullRedraw( int span ) {
+  graphDisplay.setSpan( span + 1 );
+  graphDisplay.setSpan( span );
+  graphDisplay.drawPlots();
+}
+
+static int makePlots( int count ) {
+  char name[] = "p0";
+  graphDisplay.clearPlots();
+  for (int p=0; p<count; p++) {
+    name[1] = '0' + p;
+    graphDisplay.plotId( name );
+  }
+  return count;
+}
+
+// a sawtooth per plot, its range steady so most frames can scroll,
+// unless amplitude changes it
+static void addSamples( int plots, int t, int amplitude ) {
+  for (int p=0; p<plots; p++)
+    graphDisplay.addData( p, wholeToSample( (t * (p + 2)) % 9 * amplitude / 8 - amplitude / 2 + p ) );
+}
+
+static int checkSpan( int span ) {
+  int plots = makePlots( 4 ), t = 0, bad = 0;
+  fullRedraw( span );
+  for (int chain=0; chain<200; chain++) {
+    int amplitude = chain % 10 == 0 ? 30 + rand() % 40 : 40;
+    int steps = 1 + rand() % 12;
+    for (int s=0; s<steps; s++) {
+      // now and then several samples land between two frames
+      int burst = rand() % 4 == 0 ? 2 + rand() % 3 : 1;
+      for (int b=0; b<burst; b++)
+        addSamples( plots, t++, amplitude );
+      graphDisplay.drawPlots();
+    }
+    memcpy( scrolled, vram, sizeof(scrolled) );
+    fullRedraw( span );
+    if ( memcmp( scrolled, vram, sizeof(scrolled) ) != 0 )
+      bad++;
+  }
+  return bad;
+}
+
+static double usPerSample( int plots, bool scroll ) {
+  makePlots( plots );
+  int span = DEFAULT_PLOT_SPAN, t = 0;
+  fullRedraw( span );
+  const int samples = 5000;
+  double start = hostSeconds();
+  for (int s=0; s<samples; s++) {
+    addSamples( plots, t++, 40 );
+    if ( scroll )
+      graphDisplay.drawPlots();
+    else
+      fullRedraw( span );
+  }
+  return (hostSeconds() - start) / samples * 1e6;
+}
+
+int main( void ) {
+  srand( 8 );
+  CHECK_EQ( checkSpan( DEFAULT_PLOT_SPAN ), 0 );
+  CHECK_EQ( checkSpan( 60 ), 0 );
+  CHECK_EQ( checkSpan( 2 ), 0 );
+
+  int counts[] = { 1, 5, 10 };
+  for (int plots : counts) {
+    double scroll = usPerSample( plots, true ), redraw = usPerSample( plots, false );
+    printf( "%2d plots: %.2f us per sample scrolled, %.2f us redrawn\n", plots, scroll, redraw );
+    if ( plots == 10 )
+      CHECK( scroll < redraw );
+  }
+  return hostResult();
+}
@@ -0,0 +1,75 @@
+// Tile hashing: a redraw of identical pixels is damage that sends nothing,
+// and a one pixel change sends only its tile.  Then the cost of hashing a
+// 16x16 tile against what sending it costs: the wire time at the 40 MHz
+// the DMA bus runs the panel at, and on the host the palette conversion
+// plus the mock bus.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "VramLayout.hpp"
+#include <stdlib.h>
+
+#define TILE   16
+#define TILES  ((DISPLAY_WIDTH / TILE) * (DISPLAY_HEIGHT / TILE))
+
+static void drawScene( void ) {
+  char text[] = "tile hash 42";
+  point_s a = { 10, 20 }, b = { 230, 300 }, c = { 120, 160 };
+  clear_vram( 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT );
+  draw_line( a, b, 3 );
+  draw_circle( c, 50, 5, 6 );
+  Draw_8x12_string( text, sizeof(text) - 1, 30, 250, 7 );
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  MockPanel::reset();
+  ili9341_init();
+
+  drawScene();
+  display_vram();
+
+  // cleared and drawn again, the same pixels: all damaged, nothing sent
+  drawScene();
+  MockPanel::resetStats();
+  flush_vram();
+  CHECK_EQ( MockPanel::stats().pixels, 0 );
+
+  // one pixel changed in an otherwise identical redraw
+  drawScene();
+  point_s dot = { 100, 100 };
+  draw_line( dot, dot, 9 );
+  MockPanel::resetStats();
+  flush_vram();
+  CHECK_EQ( MockPanel::stats().pixels, TILE * TILE );
+  CHECK_EQ( MockPanel::stats().windows, 1 );
+  CHECK_EQ( MockPanel::mismatches(), 0 );
+
+  // hashing every tile of the screen
+  srand( 6 );
+  for (int i=0; i<DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+    vram[i] = rand();
+  const int rounds = 2000;
+  uint32_t sum = 0;
+  double start = hostSeconds();
+  for (int r=0; r<rounds; r++)
+    for (int y=0; y<DISPLAY_HEIGHT; y+=TILE)
+      for (int x=0; x<DISPLAY_WIDTH; x+=TILE)
+        sum += vram_layout::hash_rect( vram, x, y, TILE, TILE );
+  hostKeep( sum );
+  double hashUs = (hostSeconds() - start) / rounds / TILES * 1e6;
+
+  // sending every tile, each as its own window
+  start = hostSeconds();
+  for (int r=0; r<rounds / 10; r++)
+    for (int y=0; y<DISPLAY_HEIGHT; y+=TILE)
+      for (int x=0; x<DISPLAY_WIDTH; x+=TILE)
+        blit_vram( x, y, TILE, TILE );
+  double sendUs = (hostSeconds() - start) / (rounds / 10) / TILES * 1e6;
+  double wireUs = TILE * TILE * 2 * 8 / 40e6 * 1e6;
+
+  printf( "per 16x16 tile: hash %.3f us, host send %.3f us, wire at 40 MHz %.1f us\n",
+          hashUs, sendUs, wireUs );
+  CHECK( hashUs < sendUs );
+  return hostResult();
+}
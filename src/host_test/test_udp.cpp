@@ -0,0 +1,102 @@
+// UDP load: the receive task and the display task run as on the board,
+// while senders on sockets of their own blast datagrams of text lines at
+// localhost, each holding back only once it is far enough ahead that the
+// kernel would start dropping.  Built with a pool of two buffers, so the
+// receiver runs out of buffers all the time, and with a rate window far
+// longer than the test: a release whose wakeup were missed would stall
+// the receiver, rather than cost it a timeout.  Every datagram sent must
+// be received and every sample in it reach a plot.
+
+#include "HostTest.hpp"
+#include "MockPanel.hpp"
+#include "UDPReceiver.hpp"
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+using namespace DisplayTask;
+
+static const uint16_t port      = 47219;
+static const int      senders   = 4;
+static const int      datagrams = 5000;  // per sender
+static const int      lines     = 20;    // per datagram
+static const int      ahead     = 16;    // datagrams sent and not yet received, per sender
+
+static uint32_t received( void ) {
+  return ((volatile UDPReceiver::UdpStats&) UDPReceiver::udpStats).datagrams;
+}
+
+static uint32_t appliedSamples( void ) {
+  return ((volatile DisplayStats&) displayStats).samples;
+}
+
+static std::atomic<uint32_t> sent( 0 );
+
+static void sendDatagrams( int sender ) {
+  int sock = socket( AF_INET, SOCK_DGRAM, 0 );
+  struct sockaddr_in to;
+  memset( &to, 0, sizeof(to) );
+  to.sin_family = AF_INET;
+  to.sin_port = htons( port );
+  to.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  std::string datagram;
+  for (int i=0; i<datagrams; i++) {
+    datagram.clear();
+    for (int l=0; l<lines; l++)
+      datagram += (l % 2 ? "b::" : "a::") + std::to_string( (sender * 13 + i + l) % 100 ) + "\n";
+    // a receiver that stalls ends the test
+    double start = hostSeconds();
+    while ( sent - received() >= (uint32_t) (ahead * senders) )
+      if ( hostSeconds() - start < 5 )
+        std::this_thread::yield();
+      else {
+        close( sock );
+        return;
+      }
+    if ( sendto( sock, datagram.data(), datagram.size(), 0, (struct sockaddr *) &to, sizeof(to) ) < 0 )
+      break;
+    sent++;
+  }
+  close( sock );
+}
+
+int main( void ) {
+  lcd_set_bus( &MockPanel::bus );
+  xTaskCreate( &taskFunction, "DisplayTask", 4096, NULL, 5, NULL );
+  CHECK( UDPReceiver::start( port ) );
+  vTaskDelay( 50 );
+
+  double start = hostSeconds();
+  std::vector<std::thread> threads;
+  for (int s=0; s<senders; s++)
+    threads.push_back( std::thread( sendDatagrams, s ) );
+  for (std::thread& t : threads)
+    t.join();
+  uint32_t expected = (uint32_t) senders * datagrams * lines;
+  double last = hostSeconds();
+  uint32_t samples = appliedSamples();
+  while ( samples < expected && hostSeconds() - last < 2 ) {
+    std::this_thread::yield();
+    if ( appliedSamples() != samples ) {
+      samples = appliedSamples();
+      last = hostSeconds();
+    }
+  }
+  double seconds = hostSeconds() - start;
+
+  CHECK_EQ( sent.load(), senders * datagrams );
+  CHECK_EQ( received(), sent.load() );
+  CHECK_EQ( appliedSamples(), received() * lines );
+  CHECK_EQ( UDPReceiver::udpStats.sources, senders );
+  CHECK_EQ( UDPReceiver::udpStats.sourcesRejected, 0 );
+  CHECK_EQ( parseStats.badValues, 0 );
+  printf( "%d senders: %.0f datagrams/s, %.0f samples/s, %u receives waited for a buffer\n",
+          senders, received() / seconds, appliedSamples() / seconds, UDPReceiver::udpStats.poolWaits );
+  hostExit( hostResult() );
+}
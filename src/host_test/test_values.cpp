@@ -0,0 +1,173 @@
+// Sample values: decimals and exponents parsed into fixed point must round
+// the way strtod() followed by rounding does, and values too large for a
+// sample saturate.  The parse rate is set against std::stoi and strtod,
+// and the per point y transform through Plot::scale's multiplier against
+// the integer division it replaced, which it must match within a pixel.
+
+#include "HostTest.hpp"
+#include "DisplayTask.hpp"
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace DisplayTask;
+
+static const int one = 1 << SAMPLE_FRAC_BITS;
+
+static bool parse( const std::string& text, int& value ) {
+  ParseStats stats = {};
+  std::string line = "x::" + text;
+  LineParser parser( line.data(), line.size(), stats );
+  Line l;
+  if ( !parser.next( l ) || l.kind != Line::DATA )
+    return false;
+  value = l.value;
+  return true;
+}
+
+static std::string randomValue( void ) {
+  std::string s;
+  if ( rand() % 3 == 0 )
+    s += rand() % 2 ? "-" : "+";
+  int whole = rand() % 7;
+  for (int i=0; i<whole; i++)
+    s += (char) ('0' + rand() % 10);
+  if ( whole == 0 || rand() % 2 ) {
+    s += ".";
+    int frac = 1 + rand() % 8;
+    for (int i=0; i<frac; i++)
+      s += (char) ('0' + rand() % 10);
+  }
+  if ( rand() % 4 == 0 )
+    s += std::string( rand() % 2 ? "e" : "E" ) + (rand() % 2 ? "-" : "") + std::to_string( rand() % 4 );
+  return s;
+}
+
+static void checkParse( void ) {
+  int v;
+  CHECK( parse( "3.14", v ) && v == (int) lround( 3.14 * one ) );
+  CHECK( parse( "-0.5", v ) && v == -one / 2 );
+  CHECK( parse( "2.5e3", v ) && v == 2500 * one );
+  CHECK( parse( "125E-3", v ) && v == one / 8 );
+  CHECK( parse( "0.0000001", v ) && v == 0 );
+  CHECK( parse( "1e-400", v ) && v == 0 );
+  const int largest = INT32_MAX / one;
+  CHECK( parse( std::to_string( largest ), v ) && v == largest * one );
+  CHECK( parse( std::to_string( -largest - 1 ), v ) && v == INT32_MIN );
+  // out of range saturates, never wraps
+  CHECK( parse( std::to_string( largest + 1 ), v ) && v == INT32_MAX );
+  CHECK( parse( "1e30", v ) && v == INT32_MAX );
+  CHECK( parse( "-99999999999999999999", v ) && v == INT32_MIN );
+  CHECK( !parse( "1e", v ) && !parse( ".", v ) && !parse( "-", v ) );
+
+  // random values against strtod, rounded to the nearest step; exact
+  // halves may go either way once the decimal is inexact in binary
+  int bad = 0;
+  for (int i=0; i<200000; i++) {
+    std::string s = randomValue();
+    double expected = strtod( s.c_str(), nullptr ) * one;
+    if ( fabs( expected ) >= INT32_MAX )
+      continue;
+    if ( !parse( s, v ) || fabs( v - expected ) > 0.5 + 1e-6 ) {
+      if ( bad++ < 5 )
+        printf( "    \"%s\" gave %d, strtod %.3f\n", s.c_str(), v, expected );
+    }
+  }
+  CHECK_EQ( bad, 0 );
+}
+
+static void parseRate( void ) {
+  std::vector<std::string> values;
+  std::string stream;
+  for (int i=0; i<20000; i++) {
+    values.push_back( std::to_string( rand() % 20000 - 10000 ) + "." + std::to_string( rand() % 100 ) );
+    stream += "x::" + values.back() + "\n";
+  }
+  const int passes = 50;
+  long sum = 0;
+
+  ParseStats stats = {};
+  double start = hostSeconds();
+  for (int pass=0; pass<passes; pass++) {
+    LineParser parser( stream.data(), stream.size(), stats );
+    Line line;
+    while ( parser.next( line ) )
+      sum += line.value;
+  }
+  double fixedSeconds = hostSeconds() - start;
+  CHECK_EQ( stats.dataLines, passes * values.size() );
+
+  start = hostSeconds();
+  for (int pass=0; pass<passes; pass++)
+    for (const std::string& s : values)
+      sum += std::stoi( s );
+  double stoiSeconds = hostSeconds() - start;
+
+  start = hostSeconds();
+  for (int pass=0; pass<passes; pass++)
+    for (const std::string& s : values)
+      sum += (long) strtod( s.c_str(), nullptr );
+  double strtodSeconds = hostSeconds() - start;
+  hostKeep( sum );
+
+  double n = passes * values.size();
+  printf( "parse: %.1f ns per line in fixed point, %.1f ns std::stoi (drops the fraction), %.1f ns strtod\n",
+          fixedSeconds / n * 1e9, stoiSeconds / n * 1e9, strtodSeconds / n * 1e9 );
+}
+
+static void transform( void ) {
+  const int height = 200, bottom = 239;
+  GraphDisplay::Plot plot;
+  CHECK( plot.init( "y" ) );
+  std::vector<int> samples;
+  for (int i=0; i<PLOT_HISTORY_LEN; i++) {
+    // older history spans the whole sample range, the newest is narrow
+    int v = i % 97 == 0 ? (rand() % 2 ? INT32_MAX : INT32_MIN) : (rand() % 2000001 - 1000000);
+    if ( i >= PLOT_HISTORY_LEN / 2 )
+      v = rand() % 4000 - 2000;
+    samples.push_back( v );
+    plot.shift( v );
+  }
+  const int spans[] = { 64, PLOT_HISTORY_LEN / 2, PLOT_HISTORY_LEN };
+  int worst = 0;
+  long sum = 0;
+  double fixedSeconds = 0, divideSeconds = 0;
+  for (int span : spans) {
+    plot.scale( span, height );
+    std::vector<int> window( samples.end() - span, samples.end() );
+    const int passes = 20000000 / span;
+
+    double start = hostSeconds();
+    for (int pass=0; pass<passes; pass++)
+      for (int v : window)
+        sum += bottom - (int) ((((int64_t) v - plot.min) * plot.yScale) >> 32);
+    fixedSeconds += hostSeconds() - start;
+
+    start = hostSeconds();
+    for (int pass=0; pass<passes; pass++)
+      for (int v : window)
+        sum += bottom - (int) (((int64_t) v - plot.min) * height / plot.range);
+    divideSeconds += hostSeconds() - start;
+
+    for (int v : window) {
+      int fixed = bottom - (int) ((((int64_t) v - plot.min) * plot.yScale) >> 32);
+      int divided = bottom - (int) (((int64_t) v - plot.min) * height / plot.range);
+      worst = std::max( worst, abs( fixed - divided ) );
+      CHECK( fixed >= bottom - height && fixed <= bottom );
+    }
+  }
+  hostKeep( sum );
+  CHECK( worst <= 1 );
+  double n = 3 * 20000000.0;
+  printf( "transform: %.2f ns per point multiplying, %.2f ns dividing, at most %d px apart\n",
+          fixedSeconds / n * 1e9, divideSeconds / n * 1e9, worst );
+}
+
+int main( void ) {
+  srand( 19 );
+  checkParse();
+  parseRate();
+  transform();
+  return hostResult();
+}
@@ -10,11 +10,14 @@
 #include "WirelessTask.hpp"
 #include "SerialTask.hpp"
 #include "DisplayTask.hpp"
+#include "Diagnostics.hpp"
 // include the timer components
 
 // now start the tasks that have been defined
 extern "C" void app_main(void)
 {
+  // log records and counters are kept until this task prints them
+  Diagnostics::start();
   // create the tasks
   xTaskCreate(&WirelessTask::taskFunction, // function the task runs
 	      "taskFunction_0", // name of the task (should be short)
@@ -25,14 +28,14 @@ extern "C" void app_main(void)
 	      );
   xTaskCreate(&SerialTask::taskFunction, // function the task runs
 	      "taskFunction_1", // name of the task (should be short)
-	      2048, // stack size for the task
+	      3072, // stack size for the task
 	      NULL, // parameters to task
 	      0, // priority of the task (higher -> higher priority)
 	      NULL // returned task object (don't care about storing it)
 	      );
   xTaskCreate(&DisplayTask::taskFunction, // function the task runs
 	      "taskFunction_2", // name of the task (should be short)
-	      2048, // stack size for the task
+	      4096, // stack size for the task
 	      NULL, // parameters to task
 	      0, // priority of the task (higher -> higher priority)
 	      NULL // returned task object (don't care about storing it)